@@ -0,0 +1,813 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+
+#ifdef USE_TBB
+#include <tbb/global_control.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#include "MappedFile.h"
+#include "shapes/OBJ.h"
+#include "shapes/ObjParser.h"
+#include "shapes/Sphere.h"
+#include "scenes/Scene.h"
+#include "acceleration/Accelerator.h"
+
+// Meshes fournis avec le projet, utilisés par défaut
+const std::vector<std::string> DEFAULT_MESHES = {
+    "res/obj/teapot.obj",
+    "res/obj/lemon_4k.obj",
+    "res/obj/capsule.obj"
+};
+
+constexpr int RAY_COUNT = 200000;
+
+struct RaySample {
+    Vector3 origin;
+    Vector3 direction;
+};
+
+// Compteurs matériels de défauts de cache L1 (lectures de données) et du dernier
+// niveau, lus par perf_event sous Linux. Ils restent indisponibles ailleurs, ou
+// si le noyau en refuse l'accès (machine virtuelle, perf_event_paranoid)
+class CacheCounters {
+public:
+    CacheCounters() {
+#ifdef __linux__
+        l1Fd = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        llcFd = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~CacheCounters() {
+#ifdef __linux__
+        if (l1Fd >= 0) close(l1Fd);
+        if (llcFd >= 0) close(llcFd);
+#endif
+    }
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    bool isAvailable() const { return l1Fd >= 0 && llcFd >= 0; }
+
+    void start() {
+#ifdef __linux__
+        for (const int fd : {l1Fd, llcFd}) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (const int fd : {l1Fd, llcFd}) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    long long getL1Misses() const { return read(l1Fd); }
+    long long getLLCMisses() const { return read(llcFd); }
+
+private:
+#ifdef __linux__
+    static int open(const uint32_t type, const uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    static long long read(const int fd) {
+        long long value = 0;
+#ifdef __linux__
+        if (fd >= 0 && ::read(fd, &value, sizeof(value)) != sizeof(value)) value = 0;
+#endif
+        return value;
+    }
+
+    int l1Fd = -1;
+    int llcFd = -1;
+};
+
+// Rayons déterministes partant d'une sphère englobante et visant l'intérieur de la boîte
+std::vector<RaySample> generateRays(const AABB& bounds, const int count) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const Vector3 center = bounds.getCenter();
+    const Vector3 extent = bounds.max - bounds.min;
+    const double radius = extent.norm() * 1.5;
+
+    std::vector<RaySample> rays;
+    rays.reserve(count);
+    while (static_cast<int>(rays.size()) < count) {
+        const Vector3 d(unit(rng) * 2 - 1, unit(rng) * 2 - 1, unit(rng) * 2 - 1);
+        if (d.norm() == 0.0) continue;
+        const Vector3 origin = center + d.normalized() * radius;
+        const Vector3 target = bounds.min + extent * Vector3(unit(rng), unit(rng), unit(rng));
+        const Vector3 dir = target - origin;
+        if (dir.norm() == 0.0) continue;
+        rays.push_back({origin, dir.normalized()});
+    }
+    return rays;
+}
+
+// Trace les rayons dans le BVH du mesh construit avec options. Le premier appel remplit
+// reference avec les intersections obtenues ; les suivants y comparent les leurs et
+// renvoient le nombre de rayons dont le résultat diffère
+size_t benchmarkMesh(const std::string& path, const char* label, const BVHBuildOptions& options,
+                     std::vector<Intersection>& reference) {
+    OBJ obj(path, Vector3(0, 0, 0), options);
+
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+    const BVH rebuilt(obj.getMesh()->createTriangleShapes(), options);
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    const double buildMs = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+
+    const BVH& bvh = obj.getBVH();
+    const std::vector<RaySample> rays = generateRays(bvh.getBounds(), RAY_COUNT);
+
+    size_t hits = 0;
+    const auto traceStart = std::chrono::high_resolution_clock::now();
+    for (const RaySample& ray : rays) {
+        if (obj.getIntersection(ray.origin, ray.direction)) ++hits;
+    }
+    const auto traceEnd = std::chrono::high_resolution_clock::now();
+    const double traceSec = std::chrono::duration<double>(traceEnd - traceStart).count();
+
+    size_t occluded = 0;
+    const auto shadowStart = std::chrono::high_resolution_clock::now();
+    for (const RaySample& ray : rays) {
+        if (obj.hasIntersection(ray.origin, ray.direction, Scene::EPSILON, std::numeric_limits<double>::infinity())) ++occluded;
+    }
+    const auto shadowEnd = std::chrono::high_resolution_clock::now();
+    const double shadowSec = std::chrono::duration<double>(shadowEnd - shadowStart).count();
+
+    // Hors mesure : toutes les constructions et dispositions doivent donner les mêmes
+    // intersections, à la primitive près
+    size_t mismatches = 0;
+    const bool isReference = reference.empty();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const Intersection hit = bvh.getIntersection(rays[i].origin, rays[i].direction);
+        if (isReference) {
+            reference.push_back(hit);
+        } else if (i >= reference.size() || hit != reference[i]) {
+            ++mismatches;
+        }
+    }
+
+    std::cout << std::left << std::setw(9) << label
+              << " triangles=" << std::setw(7) << obj.getTriangleCount()
+              << " nodes=" << std::setw(7) << bvh.getNodeCount()
+              << " SAH cost=" << std::setw(10) << std::setprecision(5) << bvh.getSAHCost()
+              << " build=" << std::setw(8) << std::setprecision(4) << buildMs << " ms"
+              << " rays=" << std::setprecision(4) << (rays.size() / traceSec) / 1e6 << " Mrays/s"
+              << " hits=" << hits
+              << " shadow=" << std::setprecision(4) << (rays.size() / shadowSec) / 1e6 << " Mrays/s"
+              << " occluded=" << occluded
+              << " mismatches=" << mismatches << std::endl;
+
+    const BVHStats& stats = bvh.getStats();
+    std::cout << std::left << std::setw(9) << "" << " mesh=" << obj.getMesh()->getMemoryBytes() / 1024 << " KiB ("
+              << obj.getMesh()->getMemoryBytes() / obj.getTriangleCount() << " B/triangle, BVH included)"
+              << " memory=" << stats.bytes / 1024 << " KiB"
+              << " (" << stats.bytesPerNode() << " B/node, pointer tree ~"
+              << stats.pointerTreeBytes / 1024 << " KiB, " << stats.pointerTreeBytesPerNode() << " B/node)";
+    if (stats.duplicateCount > 0) {
+        std::cout << " duplicated references=" << stats.duplicateCount;
+    }
+    if (stats.wideNodeCount > 0) {
+        std::cout << " wide nodes=" << stats.wideNodeCount << " (" << stats.wideBytes / 1024 << " KiB)";
+    }
+    if (stats.quantizedNodeCount > 0) {
+        std::cout << " quantized nodes=" << stats.quantizedNodeCount << " (" << stats.quantizedBytes / 1024
+                  << " KiB, " << std::setprecision(3) << 100.0 * stats.quantizedBytes / stats.bytes << "% of binary)";
+    }
+    std::cout << std::endl;
+    return mismatches;
+}
+
+// Ordre des nœuds aplatis : temps de parcours et défauts de cache, selon que le
+// premier enfant est toujours le gauche ou celui de plus grande aire. Renvoie le
+// nombre de rayons dont l'intersection dépend de l'ordre
+size_t benchmarkNodeOrder(const std::string& path) {
+    const std::shared_ptr<const Mesh> mesh = Mesh::load(path);
+    const std::vector<RaySample> rays = generateRays(mesh->getBVH().getBounds(), RAY_COUNT);
+    CacheCounters counters;
+
+    const std::pair<const char*, BVHNodeOrder> orders[] = {
+        {"depth-first", BVHNodeOrder::DepthFirst},
+        {"larger-first", BVHNodeOrder::LargerChildFirst}
+    };
+
+    // Mêmes triangles pour les deux ordres : leurs intersections se comparent directement
+    const std::vector<std::shared_ptr<Shape>> triangles = mesh->createTriangleShapes();
+    std::vector<Intersection> reference;
+    size_t mismatches = 0;
+    for (const auto& [label, order] : orders) {
+        BVHBuildOptions options = mesh->getBVHOptions();
+        options.nodeOrder = order;
+        const BVH bvh(triangles, options);
+
+        size_t hits = 0;
+        counters.start();
+        const auto traceStart = std::chrono::high_resolution_clock::now();
+        for (const RaySample& ray : rays) {
+            if (bvh.getIntersection(ray.origin, ray.direction)) ++hits;
+        }
+        const auto traceEnd = std::chrono::high_resolution_clock::now();
+        counters.stop();
+        const double traceSec = std::chrono::duration<double>(traceEnd - traceStart).count();
+
+        const bool isReference = reference.empty();
+        size_t orderMismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            const Intersection hit = bvh.getIntersection(rays[i].origin, rays[i].direction);
+            if (isReference) {
+                reference.push_back(hit);
+            } else if (hit != reference[i]) {
+                ++orderMismatches;
+            }
+        }
+        mismatches += orderMismatches;
+
+        std::cout << std::left << std::setw(12) << label
+                  << " rays=" << std::setprecision(4) << (rays.size() / traceSec) / 1e6 << " Mrays/s"
+                  << " hits=" << hits
+                  << " mismatches=" << orderMismatches;
+        if (counters.isAvailable()) {
+            std::cout << " L1 misses/ray=" << std::setprecision(3) << double(counters.getL1Misses()) / rays.size()
+                      << " LLC misses/ray=" << double(counters.getLLCMisses()) / rays.size();
+        } else {
+            std::cout << " (cache counters unavailable)";
+        }
+        std::cout << std::endl;
+    }
+    return mismatches;
+}
+
+// Rayons primaires d'une caméra sténopé en 1920x1080 qui cadre le mesh : tracés
+// un par un, puis par paquets de 4, 8 et 16 pixels voisins. Renvoie le nombre de
+// rayons dont l'intersection en paquet diffère de celle tracée seule
+size_t benchmarkPackets(const std::string& path) {
+    constexpr int width = 1920;
+    constexpr int height = 1080;
+
+    const std::shared_ptr<const Mesh> mesh = Mesh::load(path);
+    const BVH& bvh = mesh->getBVH();
+    const AABB bounds = bvh.getBounds();
+    const Vector3 center = bounds.getCenter();
+    const Vector3 eye = center + Vector3(0.3, 0.4, 1.0).normalized() * (1.2 * (bounds.max - bounds.min).norm());
+
+    const Vector3 forward = (center - eye).normalized();
+    const Vector3 right = forward.cross(Vector3(0, 1, 0)).normalized();
+    const Vector3 up = right.cross(forward);
+    const double screenHeight = 2.0 * std::tan(0.35);
+    const double screenWidth = screenHeight * width / height;
+
+    auto primaryRay = [&](const int x, const int y) {
+        const double u = (x + 0.5) / width - 0.5;
+        const double v = 0.5 - (y + 0.5) / height;
+        return Ray(eye, (forward + u * screenWidth * right + v * screenHeight * up).normalized(), Scene::EPSILON);
+    };
+
+    // Appelle trace(rays, count) pour chaque paquet de packetWidth x packetHeight pixels
+    auto forEachPacket = [&](const int packetWidth, const int packetHeight, auto&& trace) {
+        std::vector<Ray> rays;
+        for (int py = 0; py < height; py += packetHeight) {
+            for (int px = 0; px < width; px += packetWidth) {
+                rays.clear();
+                for (int y = py; y < std::min(py + packetHeight, height); ++y)
+                    for (int x = px; x < std::min(px + packetWidth, width); ++x)
+                        rays.push_back(primaryRay(x, y));
+                trace(rays.data(), static_cast<int>(rays.size()));
+            }
+        }
+    };
+
+    size_t mismatches = 0;
+    for (const int packetSize : {1, 4, 8, 16}) {
+        const int packetWidth = packetSize >= 8 ? 4 : (packetSize == 4 ? 2 : 1);
+        const int packetHeight = packetSize / packetWidth;
+
+        Intersection hits[BVH::MAX_PACKET_SIZE];
+        size_t hitCount = 0;
+
+        const auto traceStart = std::chrono::high_resolution_clock::now();
+        forEachPacket(packetWidth, packetHeight, [&](const Ray* rays, const int count) {
+            if (packetSize == 1) {
+                hits[0] = bvh.getIntersection(rays[0]);
+            } else {
+                bvh.getIntersections(rays, count, hits);
+            }
+            for (int i = 0; i < count; ++i) {
+                if (hits[i]) ++hitCount;
+            }
+        });
+        const auto traceEnd = std::chrono::high_resolution_clock::now();
+        const double traceSec = std::chrono::duration<double>(traceEnd - traceStart).count();
+
+        // Hors mesure : chaque rayon du paquet doit avoir l'intersection qu'il a seul
+        size_t packetMismatches = 0;
+        if (packetSize > 1) {
+            forEachPacket(packetWidth, packetHeight, [&](const Ray* rays, const int count) {
+                bvh.getIntersections(rays, count, hits);
+                for (int i = 0; i < count; ++i) {
+                    if (hits[i] != bvh.getIntersection(rays[i])) ++packetMismatches;
+                }
+            });
+        }
+        mismatches += packetMismatches;
+
+        std::cout << "packet=" << std::left << std::setw(3) << packetSize
+                  << " rays=" << std::setprecision(4) << (double(width) * height / traceSec) / 1e6 << " Mrays/s"
+                  << " hits=" << hitCount
+                  << " mismatches=" << packetMismatches << std::endl;
+    }
+    return mismatches;
+}
+
+// Mêmes formes dans chaque structure d'accélération : construction, mémoire et débit
+// des requêtes du plus proche et any-hit. Renvoie le nombre de rayons pour lesquels
+// la grille ou l'arbre kd ne donne pas le résultat du BVH
+size_t benchmarkAccelerators(const std::vector<std::shared_ptr<Shape>>& shapes) {
+    const std::pair<const char*, AcceleratorType> types[] = {
+        {"bvh", AcceleratorType::BVH},
+        {"grid", AcceleratorType::Grid},
+        {"kd-tree", AcceleratorType::KdTree}
+    };
+
+    std::vector<RaySample> rays;
+    std::vector<Intersection> referenceHits;
+    std::vector<bool> referenceOccluded;
+    size_t mismatches = 0;
+    for (const auto& [label, type] : types) {
+        const std::unique_ptr<Accelerator> accelerator = Accelerator::create(type, shapes);
+        if (rays.empty()) {
+            rays = generateRays(accelerator->getBounds(), RAY_COUNT);
+        }
+
+        size_t hits = 0;
+        const auto traceStart = std::chrono::high_resolution_clock::now();
+        for (const RaySample& ray : rays) {
+            if (accelerator->getIntersection(Ray(ray.origin, ray.direction, Scene::EPSILON))) ++hits;
+        }
+        const auto traceEnd = std::chrono::high_resolution_clock::now();
+        const double traceSec = std::chrono::duration<double>(traceEnd - traceStart).count();
+
+        size_t occluded = 0;
+        const auto shadowStart = std::chrono::high_resolution_clock::now();
+        for (const RaySample& ray : rays) {
+            if (accelerator->occluded(Ray(ray.origin, ray.direction, Scene::EPSILON))) ++occluded;
+        }
+        const auto shadowEnd = std::chrono::high_resolution_clock::now();
+        const double shadowSec = std::chrono::duration<double>(shadowEnd - shadowStart).count();
+
+        // Hors mesure : le BVH, tracé en premier, sert de référence aux autres structures
+        const bool isReference = referenceHits.empty();
+        size_t acceleratorMismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            const Ray ray(rays[i].origin, rays[i].direction, Scene::EPSILON);
+            const Intersection hit = accelerator->getIntersection(ray);
+            const bool blocked = accelerator->occluded(ray);
+            if (isReference) {
+                referenceHits.push_back(hit);
+                referenceOccluded.push_back(blocked);
+            } else if (hit != referenceHits[i] || blocked != referenceOccluded[i]) {
+                ++acceleratorMismatches;
+            }
+        }
+        mismatches += acceleratorMismatches;
+
+        const AcceleratorStats& stats = accelerator->getStats();
+        std::cout << std::left << std::setw(8) << label
+                  << " nodes=" << std::setw(8) << stats.nodeCount
+                  << " references=" << std::setw(8) << stats.primitiveCount
+                  << " memory=" << std::setw(6) << stats.bytes / 1024 << " KiB"
+                  << " build=" << std::setw(8) << std::setprecision(4) << stats.buildMilliseconds << " ms"
+                  << " rays=" << std::setprecision(4) << (rays.size() / traceSec) / 1e6 << " Mrays/s"
+                  << " hits=" << hits
+                  << " shadow=" << std::setprecision(4) << (rays.size() / shadowSec) / 1e6 << " Mrays/s"
+                  << " occluded=" << occluded
+                  << " mismatches=" << acceleratorMismatches << std::endl;
+    }
+    return mismatches;
+}
+
+// Sphères de même rayon réparties uniformément dans un cube
+std::vector<std::shared_ptr<Shape>> uniformSpheres(const int count) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const double side = std::cbrt(static_cast<double>(count));
+    std::vector<std::shared_ptr<Shape>> spheres;
+    spheres.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        spheres.push_back(std::make_shared<Sphere>(Vector3(unit(rng), unit(rng), unit(rng)) * side, 0.25f));
+    }
+    return spheres;
+}
+
+// Édition interactive : ajout, déplacement et retrait de quelques sphères dans une
+// structure existante, comparés à sa construction complète. L'arbre kd, toujours
+// reconstruit, n'est pas mesuré
+void benchmarkIncrementalEdits(const std::vector<std::shared_ptr<Shape>>& shapes, const int editCount) {
+    const std::pair<const char*, AcceleratorType> types[] = {
+        {"bvh", AcceleratorType::BVH},
+        {"grid", AcceleratorType::Grid}
+    };
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double side = std::cbrt(static_cast<double>(shapes.size()));
+
+    for (const auto& [label, type] : types) {
+        const std::unique_ptr<Accelerator> accelerator = Accelerator::create(type, shapes);
+        const double buildMs = accelerator->getStats().buildMilliseconds;
+
+        std::vector<std::shared_ptr<Shape>> added;
+        const auto insertStart = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < editCount; ++i) {
+            added.push_back(std::make_shared<Sphere>(Vector3(unit(rng), unit(rng), unit(rng)) * side, 0.25f));
+            accelerator->insert(added.back());
+        }
+        const auto insertEnd = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < editCount; ++i) {
+            const auto sphere = std::static_pointer_cast<Sphere>(shapes[(i * 7919) % shapes.size()]);
+            accelerator->remove(sphere);
+            sphere->setCenter(Vector3(unit(rng), unit(rng), unit(rng)) * side);
+            accelerator->insert(sphere);
+        }
+        const auto moveEnd = std::chrono::high_resolution_clock::now();
+
+        for (const auto& sphere : added) {
+            accelerator->remove(sphere);
+        }
+        const auto removeEnd = std::chrono::high_resolution_clock::now();
+
+        std::cout << std::left << std::setw(8) << label
+                  << " build=" << std::setw(8) << std::setprecision(4) << buildMs << " ms"
+                  << " insert=" << std::setw(8)
+                  << std::chrono::duration<double, std::milli>(insertEnd - insertStart).count() / editCount << " ms"
+                  << " move=" << std::setw(8)
+                  << std::chrono::duration<double, std::milli>(moveEnd - insertEnd).count() / editCount << " ms"
+                  << " remove=" << std::setw(8)
+                  << std::chrono::duration<double, std::milli>(removeEnd - moveEnd).count() / editCount << " ms";
+        if (type == AcceleratorType::BVH) {
+            std::cout << " edited SAH=" << static_cast<const BVH&>(*accelerator).getSAHCost()
+                      << " rebuilt SAH=" << BVH(shapes).getSAHCost();
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Place le même mesh plusieurs fois : la mémoire suit le nombre de meshes uniques
+void benchmarkInstancing(const std::string& path, const int instanceCount) {
+    const std::shared_ptr<const Mesh> mesh = Mesh::load(path);
+    const AABB bounds = mesh->getBVH().getBounds();
+    const double spacing = (bounds.max - bounds.min).norm();
+
+    std::vector<std::shared_ptr<Shape>> instances;
+    for (int i = 0; i < instanceCount; ++i) {
+        const Vector3 offset((i % 10) * spacing, 0, (i / 10) * spacing);
+        instances.push_back(std::make_shared<OBJ>(mesh, Transform::translate(offset) * Transform::rotate(i * 36.0, Vector3(0, 1, 0))));
+    }
+
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+    const BVH topLevel(instances);
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    const double buildMs = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+
+    std::cout << "instances=" << instanceCount
+              << " unique mesh memory=" << mesh->getMemoryBytes() / 1024 << " KiB"
+              << " (copies would take " << instanceCount * mesh->getMemoryBytes() / 1024 << " KiB)"
+              << " top-level nodes=" << topLevel.getNodeCount()
+              << " top-level rebuild=" << std::setprecision(4) << buildMs << " ms" << std::endl;
+}
+
+// Animation d'instances qui dérivent aléatoirement : refit à chaque image comparé
+// à une reconstruction complète, avec la dégradation du coût SAH
+void benchmarkRefit(const std::string& path, const int instanceCount, const int frameCount) {
+    const std::shared_ptr<const Mesh> mesh = Mesh::load(path);
+    const AABB bounds = mesh->getBVH().getBounds();
+    const double spacing = (bounds.max - bounds.min).norm();
+
+    std::vector<std::shared_ptr<OBJ>> instances;
+    std::vector<Vector3> positions;
+    std::vector<std::shared_ptr<Shape>> shapes;
+    for (int i = 0; i < instanceCount; ++i) {
+        const Vector3 position((i % 20) * spacing, 0, (i / 20) * spacing);
+        positions.push_back(position);
+        instances.push_back(std::make_shared<OBJ>(mesh, Transform::translate(position)));
+        shapes.push_back(instances.back());
+    }
+
+    BVH bvh(shapes);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> step(-0.5 * spacing, 0.5 * spacing);
+
+    double refitMs = 0.0;
+    double rebuildMs = 0.0;
+    int rebuilds = 0;
+    for (int frame = 1; frame <= frameCount; ++frame) {
+        for (int i = 0; i < instanceCount; ++i) {
+            positions[i] = positions[i] + Vector3(step(rng), step(rng), step(rng));
+            instances[i]->setTransform(Transform::translate(positions[i]));
+        }
+
+        const auto refitStart = std::chrono::high_resolution_clock::now();
+        const double degradation = bvh.refit();
+        const auto refitEnd = std::chrono::high_resolution_clock::now();
+        refitMs += std::chrono::duration<double, std::milli>(refitEnd - refitStart).count();
+
+        const BVH rebuilt(shapes);
+        rebuildMs += rebuilt.getStats().buildMilliseconds;
+
+        if (frame % 10 == 0) {
+            std::cout << "frame=" << std::setw(3) << frame
+                      << " refit SAH=" << std::setw(8) << std::setprecision(4) << bvh.getSAHCost()
+                      << " rebuilt SAH=" << std::setw(8) << rebuilt.getSAHCost()
+                      << " degradation=" << std::setprecision(3) << degradation << std::endl;
+        }
+        if (degradation > BVH::DEFAULT_REBUILD_THRESHOLD) {
+            bvh.update();
+            rebuilds++;
+        }
+    }
+
+    std::cout << "instances=" << instanceCount << " frames=" << frameCount
+              << " refit=" << std::setprecision(4) << refitMs / frameCount << " ms/frame"
+              << " rebuild=" << rebuildMs / frameCount << " ms/frame"
+              << " rebuilds triggered=" << rebuilds << std::endl;
+}
+
+// Chargement à froid (analyse du fichier OBJ et construction, puis écriture du cache
+// disque) comparé au chargement à chaud depuis le cache
+void benchmarkDiskCache(const std::string& path) {
+    const BVHBuildOptions options;
+    std::remove(Mesh::getCachePath(path).c_str());
+
+    const auto coldStart = std::chrono::high_resolution_clock::now();
+    const Mesh cold(path, options);
+    const auto coldEnd = std::chrono::high_resolution_clock::now();
+    const double coldMs = std::chrono::duration<double, std::milli>(coldEnd - coldStart).count();
+
+    const auto warmStart = std::chrono::high_resolution_clock::now();
+    const Mesh warm(path, options);
+    const auto warmEnd = std::chrono::high_resolution_clock::now();
+    const double warmMs = std::chrono::duration<double, std::milli>(warmEnd - warmStart).count();
+
+    std::cout << "triangles=" << std::setw(7) << warm.getTriangleCount()
+              << " cold=" << std::setw(8) << std::setprecision(4) << coldMs << " ms"
+              << " warm=" << std::setw(8) << warmMs << " ms"
+              << " (" << (warm.isLoadedFromDiskCache() ? "from cache" : "cache unavailable") << ")"
+              << " speedup=" << std::setprecision(3) << coldMs / warmMs << "x"
+              << " SAH cost " << std::setprecision(5) << cold.getBVH().getSAHCost()
+              << " / " << warm.getBVH().getSAHCost() << std::endl;
+}
+
+// Temps de construction SAH selon le nombre de threads autorisés pour TBB
+void benchmarkParallelBuild(const std::string& path) {
+    const std::shared_ptr<const Mesh> mesh = Mesh::load(path);
+    const std::vector<std::shared_ptr<Shape>> triangles = mesh->createTriangleShapes();
+
+#ifdef USE_TBB
+    const int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+#else
+    const int maxThreads = 1;
+#endif
+
+    // Puissances de deux, puis le nombre total de cœurs
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double serialMs = 0.0;
+    for (const int threads : threadCounts) {
+#ifdef USE_TBB
+        tbb::global_control control(tbb::global_control::max_allowed_parallelism, threads);
+#endif
+        // Meilleur temps sur quelques essais pour lisser le bruit
+        double bestMs = std::numeric_limits<double>::infinity();
+        for (int run = 0; run < 3; ++run) {
+            const BVH bvh(triangles, mesh->getBVHOptions());
+            bestMs = std::min(bestMs, bvh.getStats().buildMilliseconds);
+        }
+        if (threads == 1) serialMs = bestMs;
+
+        std::cout << "threads=" << std::setw(3) << threads
+                  << " build=" << std::setw(8) << std::setprecision(4) << bestMs << " ms"
+                  << " speedup=" << std::setprecision(3) << serialMs / bestMs << "x" << std::endl;
+    }
+}
+
+// Débit de l'analyse du fichier OBJ (projection en mémoire exclue) selon le nombre
+// de threads autorisés pour TBB
+void benchmarkObjParsing(const std::string& path) {
+    const MappedFile file(path);
+    const double megabytes = static_cast<double>(file.size()) / (1024.0 * 1024.0);
+
+#ifdef USE_TBB
+    const int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+#else
+    const int maxThreads = 1;
+#endif
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (const int threads : threadCounts) {
+#ifdef USE_TBB
+        tbb::global_control control(tbb::global_control::max_allowed_parallelism, threads);
+#endif
+        double bestMs = std::numeric_limits<double>::infinity();
+        size_t triangleCount = 0;
+        for (int run = 0; run < 3; ++run) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            const ObjData data = ObjParser::parse(file, path);
+            const auto end = std::chrono::high_resolution_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+            triangleCount = data.vertexIndices.size() / 3;
+        }
+
+        std::cout << "threads=" << std::setw(3) << threads
+                  << " size=" << std::setw(7) << std::setprecision(4) << megabytes << " MB"
+                  << " triangles=" << std::setw(7) << triangleCount
+                  << " parse=" << std::setw(8) << bestMs << " ms"
+                  << " throughput=" << std::setw(7) << megabytes / (bestMs / 1000.0) << " MB/s" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> meshes = DEFAULT_MESHES;
+    if (argc >= 2) {
+        meshes.assign(argv + 1, argv + argc);
+    }
+
+    BVHBuildOptions median;
+    median.splitMethod = BVHSplitMethod::Median;
+
+    BVHBuildOptions sah;
+    sah.splitMethod = BVHSplitMethod::SAH;
+
+    BVHBuildOptions lbvh;
+    lbvh.splitMethod = BVHSplitMethod::LBVH;
+
+    BVHBuildOptions hlbvh;
+    hlbvh.splitMethod = BVHSplitMethod::HLBVH;
+
+    BVHBuildOptions sbvh;
+    sbvh.splitMethod = BVHSplitMethod::SBVH;
+
+    // Feuilles d'une seule primitive contre feuilles plus grosses que la valeur par défaut
+    BVHBuildOptions leaf1 = sah;
+    leaf1.maxLeafSize = 1;
+
+    BVHBuildOptions leaf8 = sah;
+    leaf8.maxLeafSize = 8;
+
+    BVHBuildOptions wide4 = sah;
+    wide4.layout = BVHLayout::Wide4;
+
+    BVHBuildOptions wide8 = sah;
+    wide8.layout = BVHLayout::Wide8;
+
+    BVHBuildOptions quantized16 = sah;
+    quantized16.layout = BVHLayout::Quantized16;
+
+    BVHBuildOptions quantized8 = sah;
+    quantized8.layout = BVHLayout::Quantized8;
+
+    // Rayons dont l'intersection diffère de celle de la référence (BVH médian, rayon
+    // tracé seul, BVH pour la grille et l'arbre kd) : le programme échoue s'il en reste un seul
+    size_t mismatches = 0;
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== " << mesh << std::endl;
+        try {
+            std::vector<Intersection> reference;
+            mismatches += benchmarkMesh(mesh, "median", median, reference);
+            mismatches += benchmarkMesh(mesh, "sah", sah, reference);
+            mismatches += benchmarkMesh(mesh, "sah-leaf1", leaf1, reference);
+            mismatches += benchmarkMesh(mesh, "sah-leaf8", leaf8, reference);
+            mismatches += benchmarkMesh(mesh, "lbvh", lbvh, reference);
+            mismatches += benchmarkMesh(mesh, "hlbvh", hlbvh, reference);
+            mismatches += benchmarkMesh(mesh, "sbvh", sbvh, reference);
+            mismatches += benchmarkMesh(mesh, "sah-bvh4", wide4, reference);
+            mismatches += benchmarkMesh(mesh, "sah-bvh8", wide8, reference);
+            mismatches += benchmarkMesh(mesh, "sah-q16", quantized16, reference);
+            mismatches += benchmarkMesh(mesh, "sah-q8", quantized8, reference);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== node order " << mesh << std::endl;
+        try {
+            mismatches += benchmarkNodeOrder(mesh);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== primary ray packets " << mesh << std::endl;
+        try {
+            mismatches += benchmarkPackets(mesh);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "== accelerators: 100000 uniform spheres" << std::endl;
+    mismatches += benchmarkAccelerators(uniformSpheres(100000));
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== accelerators " << mesh << std::endl;
+        try {
+            mismatches += benchmarkAccelerators(Mesh::load(mesh)->createTriangleShapes());
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== parallel build " << mesh << std::endl;
+        try {
+            benchmarkParallelBuild(mesh);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== OBJ parsing " << mesh << std::endl;
+        try {
+            benchmarkObjParsing(mesh);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    for (const std::string& mesh : meshes) {
+        std::cout << "== disk cache " << mesh << std::endl;
+        try {
+            benchmarkDiskCache(mesh);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "== instancing" << std::endl;
+    try {
+        benchmarkInstancing(meshes.front(), 50);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    std::cout << "== refit" << std::endl;
+    try {
+        benchmarkRefit(meshes.front(), 1000, 60);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    std::cout << "== incremental edits: 100000 uniform spheres" << std::endl;
+    benchmarkIncrementalEdits(uniformSpheres(100000), 100);
+
+    if (mismatches > 0) {
+        std::cerr << "Error: " << mismatches << " rays disagree with the reference intersection" << std::endl;
+        return 1;
+    }
+    return 0;
+}
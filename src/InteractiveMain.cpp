@@ -40,6 +40,7 @@ void performRender(Application &application, const int width, const int height)
     const auto startTime = std::chrono::high_resolution_clock::now();
 
     application.renderer.setCamera(application.camera);
+    application.renderer.syncAccelerationStructure();
     std::vector<Vector3> frameBuffer(width * height);
 
     application.renderer.render(frameBuffer);
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include "Vector.h"
 
@@ -11,21 +13,26 @@ class Intersection {
 public:
     double lambda;      ///< Distance from ray origin (-1 means no intersection)
     Vector3 normal;     ///< Surface normal at intersection point
-    const Shape* shape; ///< Intersected shape
+    const Shape* shape; ///< Intersected shape (the instance for a mesh)
+    uint32_t primitiveIndex; ///< Mesh hits: index of the triangle hit in the mesh, 0 otherwise
+    Vector2 barycentric;    ///< Triangle hits: weights (u, v) of the second and third vertices, the first one gets 1 - u - v
     
     /**
      * @brief Constructs a valid intersection
      * @param lambda Distance from ray origin
      * @param normal Surface normal
      * @param shape Intersected shape
+     * @param primitiveIndex Index of the triangle hit, if shape is a mesh
+     * @param barycentric Barycentric coordinates of the hit, for triangles
      */
-    Intersection(const double lambda, const Vector3& normal, const Shape* shape)
-    : lambda(lambda), normal(normal), shape(shape) {}
+    Intersection(const double lambda, const Vector3& normal, const Shape* shape, const uint32_t primitiveIndex = 0,
+                 const Vector2& barycentric = Vector2())
+    : lambda(lambda), normal(normal), shape(shape), primitiveIndex(primitiveIndex), barycentric(barycentric) {}
     
     /**
      * @brief Constructs an invalid intersection (no hit)
      */
-    Intersection() : lambda(-1), shape(nullptr) {}
+    Intersection() : lambda(-1), shape(nullptr), primitiveIndex(0) {}
     
     /**
      * @brief Checks if the intersection is valid
@@ -39,7 +46,8 @@ public:
     bool operator==(const Intersection& other) const {
         return lambda == other.lambda && 
                normal == other.normal && 
-               shape == other.shape;
+               shape == other.shape &&
+               primitiveIndex == other.primitiveIndex;
     }
     
     /**
@@ -48,4 +56,10 @@ public:
     bool operator!=(const Intersection& other) const {
         return !(*this == other);
     }
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Callback invoked for each hit of an all-hits query
+ * @return false to stop the traversal
+ */
+using IntersectionCallback = std::function<bool(const Intersection&)>;
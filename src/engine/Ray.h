@@ -0,0 +1,34 @@
+#pragma once
+#include <limits>
+#include "Vector.h"
+
+/**
+ * Rayon préparé pour les tests de boîtes : l'inverse de la direction et le signe
+ * de chacune de ses composantes sont calculés une seule fois, à la construction,
+ * au lieu d'une fois par boîte traversée.
+ * Une composante nulle donne un inverse infini ; les tests de slabs qui l'utilisent
+ * (AABB::intersect, parcours du BVH) sont écrits pour que les NaN qui en résultent
+ * (0 * inf) soient ignorés par les réductions min/max.
+ */
+struct Ray {
+    // Facteur appliqué à la distance de sortie pour que les arrondis du test de slabs
+    // n'écartent jamais une boîte effleurée par le rayon : 1 + 2 * gamma(3) en double
+    // (Ize, « Robust BVH Ray Traversal », 2013)
+    static constexpr double FAR_SCALE =
+        1.0 + 2.0 * (3.0 * 0.5 * std::numeric_limits<double>::epsilon())
+                  / (1.0 - 3.0 * 0.5 * std::numeric_limits<double>::epsilon());
+
+    Vector3 origin;
+    Vector3 direction;
+    Vector3 invDirection;
+    int sign[3];  // 1 si la direction est négative : le rayon entre dans le slab par son plan max
+    double tMin;
+    double tMax;
+
+    Ray(const Vector3& origin, const Vector3& direction,
+        const double tMin = 0.0, const double tMax = std::numeric_limits<double>::infinity())
+        : origin(origin), direction(direction),
+          invDirection(1.0 / direction.x(), 1.0 / direction.y(), 1.0 / direction.z()),
+          sign{invDirection.x() < 0 ? 1 : 0, invDirection.y() < 0 ? 1 : 0, invDirection.z() < 0 ? 1 : 0},
+          tMin(tMin), tMax(tMax) {}
+};
@@ -0,0 +1,105 @@
+#include "RayQueue.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+    // Bits de la cellule d'origine par axe : une grille de 1024^3 cellules
+    constexpr int CELL_BITS = 10;
+
+    // Bits par composante de la direction, qui départagent les rayons d'une même
+    // cellule (tous les rayons primaires partent de la caméra)
+    constexpr int DIRECTION_BITS = 4;
+
+    // Répartit les CELL_BITS bits de poids faible de v un bit sur trois
+    uint32_t spreadBits(uint32_t v) {
+        v &= 0x3ff;
+        v = (v | v << 16) & 0x030000ff;
+        v = (v | v << 8) & 0x0300f00f;
+        v = (v | v << 4) & 0x030c30c3;
+        v = (v | v << 2) & 0x09249249;
+        return v;
+    }
+
+    // Clé de tri : l'octant de la direction en poids fort, puis le code de Morton de
+    // l'origine, puis la direction quantifiée
+    uint64_t sortKey(const Ray& ray, const AABB& bounds) {
+        const uint64_t octant = (ray.sign[0] << 2) | (ray.sign[1] << 1) | ray.sign[2];
+        const Vector3 extent = bounds.getExtent();
+        constexpr double scale = (1u << CELL_BITS) - 1;
+
+        uint32_t cell[3];
+        for (int a = 0; a < 3; ++a) {
+            const double t = extent[a] > 0.0 ? (ray.origin[a] - bounds.min[a]) / extent[a] : 0.0;
+            cell[a] = static_cast<uint32_t>(std::clamp(t, 0.0, 1.0) * scale);
+        }
+        const uint64_t morton = (spreadBits(cell[0]) << 2) | (spreadBits(cell[1]) << 1) | spreadBits(cell[2]);
+
+        constexpr double directionScale = (1u << DIRECTION_BITS) - 1;
+        uint64_t direction = 0;
+        for (int a = 0; a < 3; ++a) {
+            const double t = (std::clamp(ray.direction[a], -1.0, 1.0) + 1.0) * 0.5;
+            direction = (direction << DIRECTION_BITS) | static_cast<uint64_t>(t * directionScale);
+        }
+
+        return (((octant << (3 * CELL_BITS)) | morton) << (3 * DIRECTION_BITS)) | direction;
+    }
+
+    template <typename T>
+    void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+        std::vector<T> sorted;
+        sorted.reserve(values.size());
+        for (const uint32_t i : order) {
+            sorted.push_back(values[i]);
+        }
+        values.swap(sorted);
+    }
+}
+
+void RayQueue::push(const Ray& ray, const Vector3& weight, const uint32_t pixel) {
+    rays.push_back(ray);
+    weights.push_back(weight);
+    pixels.push_back(pixel);
+}
+
+void RayQueue::sort(const AABB& bounds) {
+    // L'indice départage les clés égales : l'ordre obtenu ne dépend pas de l'implémentation du tri
+    std::vector<std::pair<uint64_t, uint32_t>> keyed(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        keyed[i] = {sortKey(rays[i], bounds), static_cast<uint32_t>(i)};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<uint32_t> order(rays.size());
+    for (size_t i = 0; i < keyed.size(); ++i) {
+        order[i] = keyed[i].second;
+    }
+
+    permute(rays, order);
+    permute(weights, order);
+    permute(pixels, order);
+}
+
+void RayQueue::scaleWeights(const size_t begin, const Vector3& factor) {
+    for (size_t i = begin; i < weights.size(); ++i) {
+        weights[i] = weights[i] * factor;
+    }
+}
+
+void RayQueue::truncate(const size_t count) {
+    if (count >= rays.size()) return;
+    rays.erase(rays.begin() + count, rays.end());
+    weights.resize(count);
+    pixels.resize(count);
+}
+
+void RayQueue::clear() {
+    rays.clear();
+    weights.clear();
+    pixels.clear();
+}
+
+void RayQueue::reserve(const size_t count) {
+    rays.reserve(count);
+    weights.reserve(count);
+    pixels.reserve(count);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Ray.h"
+#include "Vector.h"
+#include "acceleration/AABB.h"
+
+/**
+ * File des rayons d'un rebond du rendu wavefront, rangée par composante : les
+ * rayons sont contigus pour être tracés par paquets, leur poids (contribution à
+ * la couleur du pixel) et leur pixel sont à part. Dans les files de rayons d'ombre,
+ * pixel désigne le rayon du rebond dont la couleur reçoit la contribution.
+ * sort() regroupe les rayons par octant de direction, puis par cellule d'origine
+ * (code de Morton dans la boîte de la scène), puis par direction : des rayons
+ * voisins dans la file partent d'un même endroit dans la même direction et
+ * parcourent les mêmes nœuds.
+ */
+class RayQueue {
+public:
+    void push(const Ray& ray, const Vector3& weight, uint32_t pixel);
+
+    // Tri par octant de direction, cellule d'origine dans bounds, puis direction
+    void sort(const AABB& bounds);
+
+    // Multiplie par factor le poids des rayons à partir de l'indice begin
+    void scaleWeights(size_t begin, const Vector3& factor);
+
+    // Ne garde que les count premiers rayons
+    void truncate(size_t count);
+
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return rays.size(); }
+    bool empty() const { return rays.empty(); }
+
+    const Ray* getRays() const { return rays.data(); }
+    const Ray& getRay(const size_t i) const { return rays[i]; }
+    const Vector3& getWeight(const size_t i) const { return weights[i]; }
+    uint32_t getPixel(const size_t i) const { return pixels[i]; }
+
+private:
+    std::vector<Ray> rays;
+    std::vector<Vector3> weights;
+    std::vector<uint32_t> pixels;
+};
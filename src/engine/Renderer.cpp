@@ -1,9 +1,12 @@
 #include "Renderer.h"
 #include "LightSource.h"
 #include "shapes/Shape.h"
+#include "RayQueue.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <execution>
+#include <functional>
 
 #ifdef _WIN32
   #include <corecrt_math_defines.h>  // Windows (Visual Studio)
@@ -26,6 +29,39 @@ void Renderer::render(std::vector<Vector3> &frameBuffer) const
     const double screenHeight = 2.0 * tan(fovRad / 2.0);
     const double screenWidth = screenHeight * aspectRatio;
 
+    // Calcul des vecteurs de base de la caméra
+    const Vector3 forward = this->camera_.getDirection();       // direction caméra
+    const Vector3 right = this->camera_.getRight();              // vecteur droit
+    const Vector3 up = this->camera_.getUp();                     // vecteur haut
+
+    // Direction dans l'espace monde du rayon primaire du pixel (x, y)
+    const auto primaryDirection = [&](const int x, const int y)
+    {
+        // Normalisation des coordonnées écran entre -0.5 et 0.5
+        const double u = (x + 0.5) / width - 0.5;
+        const double v = 0.5 - (y + 0.5) / height;
+
+        // Passage aux dimensions physiques de l'écran virtuel (screen plane)
+        const double px = u * screenWidth;
+        const double py = v * screenHeight;
+
+        return (forward + px * right + py * up).normalized();
+    };
+
+    // Le rendu wavefront parallélise chaque rebond d'une tuile plutôt que les blocs
+    if (this->wavefrontEnabled)
+    {
+        for (int y0 = 0; y0 < height; y0 += WAVEFRONT_TILE_SIZE)
+        {
+            for (int x0 = 0; x0 < width; x0 += WAVEFRONT_TILE_SIZE)
+            {
+                renderWavefront(frameBuffer, x0, y0, std::min(x0 + WAVEFRONT_TILE_SIZE, width),
+                                std::min(y0 + WAVEFRONT_TILE_SIZE, height), primaryDirection);
+            }
+        }
+        return;
+    }
+
     const int blockSize = 32; // Taille des blocs
 
     // Découpage en blocs pour le parallélisme
@@ -49,27 +85,17 @@ void Renderer::render(std::vector<Vector3> &frameBuffer) const
             const int maxY = std::min(by + blockSize, height);
             const int maxX = std::min(bx + blockSize, width);
 
+            if (this->packetSize > 1)
+            {
+                renderPackets(frameBuffer, bx, by, maxX, maxY, primaryDirection);
+                return;
+            }
+
             for (int y = by; y < maxY; ++y)
             {
                 for (int x = bx; x < maxX; ++x)
                 {
-                    // Normalisation des coordonnées écran entre -0.5 et 0.5
-                    const double u = (x + 0.5) / width - 0.5;
-                    const double v = 0.5 - (y + 0.5) / height;
-
-                    // Passage aux dimensions physiques de l'écran virtuel (screen plane)
-                    const double px = u * screenWidth;
-                    const double py = v * screenHeight;
-
-                    // Calcul des vecteurs de base de la caméra
-                    Vector3 forward = this->camera_.getDirection();       // direction caméra
-                    Vector3 right = this->camera_.getRight();              // vecteur droit
-                    Vector3 up = this->camera_.getUp();                     // vecteur haut
-
-                    // Calcul du vecteur direction du rayon dans l'espace monde
-                    Vector3 rayDir = (forward + px * right + py * up).normalized();
-
-                    frameBuffer[y * width + x] = getPixelColor(observer, rayDir, 10);
+                    frameBuffer[y * width + x] = getPixelColor(observer, primaryDirection(x, y), MAX_BOUNCES);
                 }
             }
         });
@@ -116,10 +142,256 @@ void Renderer::setCamera(const Camera& camera)
     this->camera_ = camera;
 }
 
+void Renderer::rebuildAccelerationStructure()
+{
+    this->accelerator_ = Accelerator::create(this->accelerator_->getType(), this->scene->getShapes());
+    clearShapeChanges();
+}
+
+void Renderer::setAcceleratorType(const AcceleratorType type)
+{
+    this->accelerator_ = Accelerator::create(type, this->scene->getShapes());
+    clearShapeChanges();
+}
+
+bool Renderer::refitAccelerationStructure(const double rebuildThreshold)
+{
+    return this->accelerator_->update(rebuildThreshold);
+}
+
+bool Renderer::syncAccelerationStructure()
+{
+    const Scene::ShapeChanges changes = this->scene->takeShapeChanges();
+    for (const auto& shape : changes.added)
+        shape->clearBoundsDirty();
+    for (const auto& shape : changes.removed)
+        shape->clearBoundsDirty();
+
+    // Formes déjà présentes dont la géométrie a changé : retirées puis réinsérées
+    std::vector<std::shared_ptr<Shape>> moved;
+    for (const auto& shape : this->scene->getShapes())
+    {
+        if (shape->isBoundsDirty())
+            moved.push_back(shape);
+    }
+
+    const size_t editCount = changes.added.size() + changes.removed.size() + moved.size();
+    if (editCount == 0)
+        return false;
+
+    // L'arbre kd se reconstruit à chaque modification : autant ne le faire qu'une fois
+    if (editCount > MAX_INCREMENTAL_EDITS || this->accelerator_->getType() == AcceleratorType::KdTree)
+    {
+        rebuildAccelerationStructure();
+        return true;
+    }
+
+    for (const auto& shape : changes.removed)
+        this->accelerator_->remove(shape);
+    for (const auto& shape : moved)
+    {
+        this->accelerator_->remove(shape);
+        this->accelerator_->insert(shape);
+        shape->clearBoundsDirty();
+    }
+    for (const auto& shape : changes.added)
+        this->accelerator_->insert(shape);
+
+    // Les modifications une à une dégradent peu à peu la structure d'une
+    // synchronisation à l'autre : une fois trop loin de sa construction, elle est reconstruite
+    if (this->accelerator_->needsRebuild(BVH::DEFAULT_REBUILD_THRESHOLD))
+    {
+        rebuildAccelerationStructure();
+        return true;
+    }
+    return false;
+}
+
+void Renderer::clearShapeChanges()
+{
+    this->scene->takeShapeChanges();
+    for (const auto& shape : this->scene->getShapes())
+        shape->clearBoundsDirty();
+}
+
+
+void Renderer::renderPackets(std::vector<Vector3> &frameBuffer, const int bx, const int by, const int maxX, const int maxY,
+                              const std::function<Vector3(int, int)> &primaryDirection) const
+{
+    const Vector3 observer = this->camera_.getPosition();
+
+    // Paquets carrés (2x2, 4x4) ou 4x2 pour 8 rayons : les rayons restent voisins à l'écran
+    const int size = std::min(this->packetSize, BVH::MAX_PACKET_SIZE);
+    const int packetWidth = size >= 8 ? 4 : 2;
+    const int packetHeight = std::max(1, size / packetWidth);
+
+    std::vector<Ray> rays;
+    rays.reserve(packetWidth * packetHeight);
+    Intersection hits[BVH::MAX_PACKET_SIZE];
+
+    for (int py = by; py < maxY; py += packetHeight)
+    {
+        for (int px = bx; px < maxX; px += packetWidth)
+        {
+            // Les paquets du bord de l'image sont simplement incomplets
+            rays.clear();
+            for (int y = py; y < std::min(py + packetHeight, maxY); ++y)
+                for (int x = px; x < std::min(px + packetWidth, maxX); ++x)
+                    rays.emplace_back(observer, primaryDirection(x, y), Scene::EPSILON);
+
+            this->accelerator_->getIntersections(rays.data(), static_cast<int>(rays.size()), hits);
+
+            int i = 0;
+            for (int y = py; y < std::min(py + packetHeight, maxY); ++y)
+                for (int x = px; x < std::min(px + packetWidth, maxX); ++x, ++i)
+                    frameBuffer[y * width + x] = shadeIntersection(observer, rays[i].direction, hits[i], MAX_BOUNCES);
+        }
+    }
+}
+
+void Renderer::renderWavefront(std::vector<Vector3> &frameBuffer, const int x0, const int y0, const int x1, const int y1,
+                               const std::function<Vector3(int, int)> &primaryDirection) const
+{
+    const Vector3 observer = this->camera_.getPosition();
+    const AABB sceneBounds = this->accelerator_->getBounds();
+
+    // Rayons primaires rangés par carrés de 4x4 pixels, déjà cohérents : pas de tri au premier rebond
+    RayQueue queue;
+    queue.reserve(static_cast<size_t>(x1 - x0) * (y1 - y0));
+    for (int py = y0; py < y1; py += 4)
+    {
+        for (int px = x0; px < x1; px += 4)
+        {
+            for (int y = py; y < std::min(py + 4, y1); ++y)
+            {
+                for (int x = px; x < std::min(px + 4, x1); ++x)
+                {
+                    frameBuffer[y * width + x] = Vector3(0, 0, 0);
+                    queue.push(Ray(observer, primaryDirection(x, y), Scene::EPSILON), Vector3(1, 1, 1), y * width + x);
+                }
+            }
+        }
+    }
+
+    traceWavefront(frameBuffer, queue, MAX_BOUNCES, sceneBounds);
+}
+
+void Renderer::traceWavefront(std::vector<Vector3> &frameBuffer, RayQueue &queue, const int order,
+                              const AABB &sceneBounds) const
+{
+    if (order < MAX_BOUNCES)
+        queue.sort(sceneBounds);
+
+    // La file est traitée par tranches : dès que le rebond suivant dépasse la taille
+    // maximale, il est tracé avant de poursuivre, ce qui borne la mémoire de chaque
+    // niveau au lieu de la laisser doubler à chaque surface vitrée
+    RayQueue next;
+    for (size_t first = 0; first < queue.size(); first += WAVEFRONT_MAX_QUEUE_SIZE)
+    {
+        const size_t last = std::min(first + WAVEFRONT_MAX_QUEUE_SIZE, queue.size());
+
+        // Chaque tâche trace un lot de rayons consécutifs par paquets, puis les ombre
+        std::vector<size_t> batches;
+        for (size_t begin = first; begin < last; begin += WAVEFRONT_BATCH_SIZE)
+        {
+            batches.push_back(begin);
+        }
+
+        std::vector<Vector3> colors(last - first);
+        std::vector<SecondaryRays> secondaryRays(last - first);
+
+        std::for_each(
+            std::execution::par,
+            batches.begin(),
+            batches.end(),
+            [&](const size_t begin)
+            {
+                const size_t end = std::min<size_t>(begin + WAVEFRONT_BATCH_SIZE, last);
+                Intersection hits[WAVEFRONT_BATCH_SIZE];
+                for (size_t i = begin; i < end; i += BVH::MAX_PACKET_SIZE)
+                {
+                    const int packetCount = static_cast<int>(std::min<size_t>(BVH::MAX_PACKET_SIZE, end - i));
+                    this->accelerator_->getIntersections(queue.getRays() + i, packetCount, &hits[i - begin]);
+                }
+
+                // Les rayons d'ombre du lot sont reportés puis tracés ensemble, tant
+                // qu'ils sont encore en cache ; produits point par point et lumière par
+                // lumière, ils sont déjà cohérents et ne sont pas triés
+                DeferredShadows shadows;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const Ray& ray = queue.getRay(i);
+                    shadows.target = static_cast<uint32_t>(i - first);
+                    colors[i - first] = shadeSurface(ray.origin, ray.direction, hits[i - begin], order,
+                                                     secondaryRays[i - first], &shadows);
+                }
+                traceShadowRays(shadows.filtered, true, colors.data());
+                traceShadowRays(shadows.blocked, false, colors.data());
+            });
+
+        // Accumulation dans l'image et file du rebond suivant, poids composés le long du chemin
+        for (size_t i = first; i < last; ++i)
+        {
+            const Vector3& weight = queue.getWeight(i);
+            const uint32_t pixel = queue.getPixel(i);
+            frameBuffer[pixel] += colors[i - first] * weight;
+
+            const SecondaryRays& secondaries = secondaryRays[i - first];
+            for (int r = 0; r < secondaries.count; ++r)
+            {
+                const SecondaryRays::Entry& secondary = secondaries.entries[r];
+                const Vector3 pathWeight = weight * secondary.weight;
+                if (std::max({pathWeight.x(), pathWeight.y(), pathWeight.z()}) < WAVEFRONT_PATH_CUTOFF)
+                    continue;
+                next.push(Ray(secondary.origin, secondary.direction, Scene::EPSILON), pathWeight, pixel);
+            }
+        }
+
+        if (next.size() >= WAVEFRONT_MAX_QUEUE_SIZE)
+        {
+            traceWavefront(frameBuffer, next, order - 1, sceneBounds);
+            next.clear();
+        }
+    }
+
+    if (!next.empty())
+        traceWavefront(frameBuffer, next, order - 1, sceneBounds);
+}
+
+void Renderer::traceShadowRays(const RayQueue &shadowRays, const bool filtered, Vector3 *colors) const
+{
+    for (size_t i = 0; i < shadowRays.size(); ++i)
+    {
+        const Ray& ray = shadowRays.getRay(i);
+        if (filtered)
+            colors[shadowRays.getPixel(i)] += shadowRays.getWeight(i) * computeShadowAttenuation(ray.origin, ray.direction, ray.tMax);
+        else if (!isInShadow(ray.origin, ray.direction, ray.tMax))
+            colors[shadowRays.getPixel(i)] += shadowRays.getWeight(i);
+    }
+}
 
 Vector3 Renderer::getPixelColor(const Vector3 &P, const Vector3 &v, const int &order) const
 {
-    const Intersection result = findNearestIntersection(P, v);
+    return shadeIntersection(P, v, findNearestIntersection(P, v), order);
+}
+
+Vector3 Renderer::shadeIntersection(const Vector3 &P, const Vector3 &v, const Intersection &result, const int &order) const
+{
+    SecondaryRays secondaryRays;
+    Vector3 color = shadeSurface(P, v, result, order, secondaryRays);
+
+    for (int i = 0; i < secondaryRays.count; ++i)
+    {
+        const SecondaryRays::Entry& secondary = secondaryRays.entries[i];
+        color += getPixelColor(secondary.origin, secondary.direction, order - 1) * secondary.weight;
+    }
+
+    return color;
+}
+
+Vector3 Renderer::shadeSurface(const Vector3 &P, const Vector3 &v, const Intersection &result, const int &order,
+                               SecondaryRays &secondaryRays, DeferredShadows *deferredShadows) const
+{
     if (!result || result.shape == nullptr)
         return this->scene->getSkyColor();
 
@@ -128,7 +400,7 @@ Vector3 Renderer::getPixelColor(const Vector3 &P, const Vector3 &v, const int &o
 
     // Wireframe check
     if (result.shape->isWireframeEnabled()) {
-        const double distance = result.shape->getDistanceNearestEdge(intersectionPoint, this->camera_);
+        const double distance = result.shape->getHitDistanceNearestEdge(result, intersectionPoint, this->camera_);
         if (distance < Scene::WIREFRAME_THICKNESS)
             return Scene::WIREFRAME_COLOR;
     }
@@ -136,7 +408,7 @@ Vector3 Renderer::getPixelColor(const Vector3 &P, const Vector3 &v, const int &o
     Vector3 color;
     if (result.shape->hasTexture() && this->textureEnabled)
     {
-        Vector2 texCoords = result.shape->getTextureCoordinates(intersectionPoint);
+        Vector2 texCoords = result.shape->getHitTextureCoordinates(result, intersectionPoint);
         texCoords.clamp(0, 1);
         color = result.shape->getTexture()->getTextureColor(texCoords);
     } else
@@ -151,37 +423,40 @@ Vector3 Renderer::getPixelColor(const Vector3 &P, const Vector3 &v, const int &o
     // Si le matériau a metallic > 0, utiliser microfacettes, sinon ancien modèle
     if (material.getMetallic() > 0.0 || material.getRoughness() > 0.5) {
         // Nouveau modèle microfacettes
-        Vector3 microfacetsLight = computeMicrofacetsLighting(P, v, intersectionPoint, normal, *result.shape);
+        const size_t firstDeferred = deferredShadows ? deferredShadows->blocked.size() : 0;
+        Vector3 microfacetsLight = computeMicrofacetsLighting(P, v, intersectionPoint, normal, *result.shape, deferredShadows);
 
         // Vérifier que le résultat est valide
         if (std::isfinite(microfacetsLight.x()) && std::isfinite(microfacetsLight.y()) && std::isfinite(microfacetsLight.z())) {
             color += microfacetsLight * result.shape->getColor(); // Multiplier par la couleur
+            if (deferredShadows)
+                deferredShadows->blocked.scaleWeights(firstDeferred, result.shape->getColor());
         } else {
             // Fallback vers l'ancien modèle si problème
-            color += computeLighting(P, v, intersectionPoint, normal, *result.shape);
+            if (deferredShadows)
+                deferredShadows->blocked.truncate(firstDeferred);
+            color += computeLighting(P, v, intersectionPoint, normal, result, deferredShadows);
         }
     } else {
         // Ancien modèle pour les matériaux simples
-        color += computeLighting(P, v, intersectionPoint, normal, *result.shape);
+        color += computeLighting(P, v, intersectionPoint, normal, result, deferredShadows);
     }
 
     // Réflexions
     if (order > 0) {
         if (material.getReflectivity() > 0.0 || material.getMetallic() > 0.0) {
-            Vector3 reflectionColor;
+            const double reflectionWeight = std::max(material.getReflectivity(), material.getMetallic());
 
             if (material.getMetallic() > 0.0 && this->reflectionsEnabled) {
-                reflectionColor = sampleMicrofacetsReflection(P, v, intersectionPoint, normal, *result.shape, order);
+                sampleMicrofacetsReflection(P, v, intersectionPoint, normal, result, secondaryRays, reflectionWeight);
             } else if (this->reflectionsEnabled) {
-                reflectionColor = computeReflection(P, v, intersectionPoint, normal, *result.shape, order);
+                computeReflection(P, v, intersectionPoint, normal, result, secondaryRays, reflectionWeight);
             }
-
-            color += reflectionColor * std::max(material.getReflectivity(), material.getMetallic());
         }
 
         // Réfraction (garder l'ancien pour l'instant)
         if (material.getTransparency() > 0.0 && this->refractionsEnabled) {
-            color += computeRefraction(P, v, intersectionPoint, normal, *result.shape, order, material.getTransparency());
+            computeRefraction(P, v, intersectionPoint, normal, result, secondaryRays, material.getTransparency());
         }
     }
 
@@ -190,10 +465,10 @@ Vector3 Renderer::getPixelColor(const Vector3 &P, const Vector3 &v, const int &o
 
 Intersection Renderer::findNearestIntersection(const Vector3 &P, const Vector3 &v) const
 {
-    return this->bvh_.getIntersection(P, v);
+    return this->accelerator_->getIntersection(Ray(P, v, Scene::EPSILON));
 }
 
-double Renderer::computeCurvatureBias(const Shape& shape,
+double Renderer::computeCurvatureBias(const Intersection& hit,
                                      const Vector3& intersectionPoint,
                                      const Vector3& normal,
                                      const Vector3& rayDir) const {
@@ -204,7 +479,7 @@ double Renderer::computeCurvatureBias(const Shape& shape,
     const double cosTheta = std::abs(normal.dot(rayDir));
     const double curvatureBias = 1e-3 * (1.0 - cosTheta); // Ajustez 1e-3 selon vos besoins
 
-    const double edgeDistance = shape.getDistanceNearestEdge(intersectionPoint, camera_);
+    const double edgeDistance = hit.shape->getHitDistanceNearestEdge(hit, intersectionPoint, camera_);
     const double edgeBias = 1e-4 * std::max(0.0, 1.0 - edgeDistance / Scene::WIREFRAME_THICKNESS);
     return distanceBias + curvatureBias + edgeBias;
 }
@@ -213,8 +488,10 @@ Vector3 Renderer::computeLighting(const Vector3 &P,
                                   const Vector3 &v,
                                   const Vector3 &intersectionPoint,
                                   const Vector3 &normal,
-                                  const Shape &shape) const
+                                  const Intersection &hit,
+                                  DeferredShadows *deferredShadows) const
 {
+    const Shape &shape = *hit.shape;
     Vector3 result(0, 0, 0);
 
     // Nombre d'échantillons pour l’area light (1 = point light pur)
@@ -233,12 +510,16 @@ Vector3 Renderer::computeLighting(const Vector3 &P,
             Vector3 Lvec     = samplePos - intersectionPoint;
             double  Ldist    = Lvec.norm();
             Vector3 Ldir     = Lvec * (1 / Ldist);
-            Vector3 shadowOrig = intersectionPoint + Ldir * computeCurvatureBias(shape, intersectionPoint, Ldir, v);
+            Vector3 shadowOrig = intersectionPoint + Ldir * computeCurvatureBias(hit, intersectionPoint, Ldir, v);
 
-            // 2) On calcule l’atténuation d’ombre colorée
-            Vector3 attenShadow = computeShadowAttenuation(shadowOrig, Ldir, Ldist);
-            if (attenShadow.x() <= 0.0 && attenShadow.y() <= 0.0 && attenShadow.z() <= 0.0)
-                continue; // entièrement bloqué
+            // 2) On calcule l’atténuation d’ombre colorée (plus tard, rayon groupé avec les autres, en wavefront)
+            Vector3 attenShadow(1, 1, 1);
+            if (!deferredShadows)
+            {
+                attenShadow = computeShadowAttenuation(shadowOrig, Ldir, Ldist);
+                if (attenShadow.x() <= 0.0 && attenShadow.y() <= 0.0 && attenShadow.z() <= 0.0)
+                    continue; // entièrement bloqué
+            }
 
             // 3) Diffuse
             double NdotL = std::max(0.0, normal.dot(Ldir));
@@ -263,6 +544,14 @@ Vector3 Renderer::computeLighting(const Vector3 &P,
                 attenDist = computeAttenuation(Ldist);
             }
 
+            if (deferredShadows)
+            {
+                deferredShadows->filtered.push(Ray(shadowOrig, Ldir, Scene::EPSILON, Ldist),
+                                               (diffuse + specular) * attenDist / this->samplesNumber,
+                                               deferredShadows->target);
+                continue;
+            }
+
             // 6) On cumule ce que voit ce sample
             accumLight += (diffuse + specular) * attenDist * attenShadow;
         }
@@ -276,44 +565,36 @@ Vector3 Renderer::computeLighting(const Vector3 &P,
 
 bool Renderer::isInShadow(const Vector3 &shadowOrigin, const Vector3 &shadowRayDir, const double lightDistance) const
 {
-    const Intersection intersection = this->bvh_.getIntersection(shadowOrigin, shadowRayDir);
-    return intersection.lambda > Scene::EPSILON
-        && intersection.shape != nullptr
-        && intersection.lambda < lightDistance;
+    return this->accelerator_->occluded(Ray(shadowOrigin, shadowRayDir, Scene::EPSILON, lightDistance));
 }
 
 Vector3 Renderer::computeShadowAttenuation(const Vector3& origin, const Vector3& dir, double lightDist) const
 {
     Vector3 attenuation(1, 1, 1);
-    Vector3 currOrig = origin;
-    Vector3 currDir = dir;
 
-    while (true)
+    // Un seul parcours de la structure d'accélération collecte tous les obstacles entre le point et la lumière
+    this->accelerator_->forEachHit(Ray(origin, dir, Scene::EPSILON, lightDist), [&attenuation](const Intersection& hit)
     {
-        Intersection hit = this->bvh_.getIntersection(currOrig, currDir);
-        // si pas d'intersection ou intersection au-delà de la lumière, on s'arrête
-        if (!hit || hit.lambda >= lightDist)
-            break;
-
         const Shape* sh = hit.shape;
-        const Material& m = sh->getMaterial();
-        double t = m.getTransparency();         // [0,1]
-        Vector3 col = sh->getColor();           // couleur de l’objet
-        // on filtre l’atténuation : la lumière est multipliée par t * col
-        attenuation = attenuation * (t * col);
+        const double t = sh->getMaterial().getTransparency(); // [0,1]
         // si l’objet est totalement opaque, on coupe tout
         if (t <= 0.0)
-            return {0, 0, 0};
-
-        // avancer l’origine juste après l’intersection
-        Vector3 hitPt = currOrig + currDir * hit.lambda;
-        currOrig = hitPt + currDir * Scene::EPSILON;
+        {
+            attenuation = Vector3(0, 0, 0);
+            return false;
+        }
 
-        // réduire la distance restante jusqu’à la lumière
-        lightDist -= hit.lambda + Scene::EPSILON;
-        if (attenuation.x() <= 1e-3 && attenuation.y() <= 1e-3 && attenuation.z() <= 1e-3)
-            return {0, 0, 0};
-    }
+        // on filtre l’atténuation : la lumière est multipliée par t * col
+        attenuation = attenuation * (t * sh->getColor());
+        if (attenuation.x() <= SHADOW_ATTENUATION_CUTOFF
+            && attenuation.y() <= SHADOW_ATTENUATION_CUTOFF
+            && attenuation.z() <= SHADOW_ATTENUATION_CUTOFF)
+        {
+            attenuation = Vector3(0, 0, 0);
+            return false;
+        }
+        return true;
+    });
 
     return attenuation;
 }
@@ -410,11 +691,13 @@ std::pair<double, double> Renderer::computeFresnelCoefficients(const Vector3& in
 }
 
 // Modification de computeReflection pour prendre un coefficient
-Vector3 Renderer::computeReflection(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
-                                    const Vector3 &normal, const Shape &shape, const int &order, double fresnelR) const
+void Renderer::computeReflection(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
+                                 const Vector3 &normal, const Intersection &hit, SecondaryRays &secondaryRays,
+                                 double fresnelR) const
 {
+    const Shape &shape = *hit.shape;
     if (fresnelR <= 0.0)
-        return Vector3(0, 0, 0);
+        return;
 
     Vector3 reflectDir = (v - normal * 2 * normal.dot(v)).normalized();
 
@@ -427,16 +710,18 @@ Vector3 Renderer::computeReflection(const Vector3 &P, const Vector3 &v, const Ve
         }
     }
 
-    Vector3 offset = reflectDir * computeCurvatureBias(shape, intersectionPoint, reflectDir, v);
-    return getPixelColor(intersectionPoint + offset, reflectDir, order - 1) * fresnelR;
+    Vector3 offset = reflectDir * computeCurvatureBias(hit, intersectionPoint, reflectDir, v);
+    secondaryRays.add(intersectionPoint + offset, reflectDir, Vector3(fresnelR, fresnelR, fresnelR));
 }
 
 // Modification de computeRefraction pour prendre un coefficient
-Vector3 Renderer::computeRefraction(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
-                                    const Vector3 &normal, const Shape &shape, const int &order, double fresnelT) const
+void Renderer::computeRefraction(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
+                                 const Vector3 &normal, const Intersection &hit, SecondaryRays &secondaryRays,
+                                 double fresnelT) const
 {
+    const Shape &shape = *hit.shape;
     if (fresnelT <= 0.0)
-        return Vector3(0, 0, 0);
+        return;
 
     const Vector3 i = v.normalized();
     Vector3 n = normal.normalized();
@@ -466,14 +751,15 @@ Vector3 Renderer::computeRefraction(const Vector3 &P, const Vector3 &v, const Ve
     {
         const double c2 = std::sqrt(k);
         const Vector3 refractDir = (i * eta + n * (eta * c1 - c2)).normalized();
-        const Vector3 offset = refractDir * computeCurvatureBias(shape, intersectionPoint, refractDir, v);
-        return getPixelColor(intersectionPoint + offset, refractDir, order - 1) * fresnelT;
+        const Vector3 offset = refractDir * computeCurvatureBias(hit, intersectionPoint, refractDir, v);
+        secondaryRays.add(intersectionPoint + offset, refractDir, Vector3(fresnelT, fresnelT, fresnelT));
+        return;
     }
 
     // Réflexion totale interne - on utilise la réflexion
     const Vector3 reflectDir = (i - n * 2 * n.dot(i)).normalized();
-    const Vector3 offset = reflectDir * computeCurvatureBias(shape, intersectionPoint, reflectDir, v);
-    return getPixelColor(intersectionPoint + offset, reflectDir, order - 1);
+    const Vector3 offset = reflectDir * computeCurvatureBias(hit, intersectionPoint, reflectDir, v);
+    secondaryRays.add(intersectionPoint + offset, reflectDir, Vector3(1, 1, 1));
 }
 
 Vector3 Renderer::computeMicrofacetsBRDF(const Vector3& viewDir, const Vector3& lightDir,
@@ -533,7 +819,8 @@ Vector3 Renderer::computeMicrofacetsBRDF(const Vector3& viewDir, const Vector3&
 
 Vector3 Renderer::computeMicrofacetsLighting(const Vector3& P, const Vector3& v,
                                            const Vector3& intersectionPoint,
-                                           const Vector3& normal, const Shape& shape) const
+                                           const Vector3& normal, const Shape& shape,
+                                           DeferredShadows* deferredShadows) const
 {
     Vector3 result(0, 0, 0);
     Vector3 viewDir = (P - intersectionPoint).normalized();
@@ -552,9 +839,10 @@ Vector3 Renderer::computeMicrofacetsLighting(const Vector3& P, const Vector3& v,
             Vector3 Ldir = Lvec / Ldist;
 
             // Test d'ombre simple
-            if (this->shadowsEnabled)
+            const bool deferShadow = this->shadowsEnabled && deferredShadows;
+            Vector3 shadowOrig = intersectionPoint + normal * 0.001; // Offset simple
+            if (this->shadowsEnabled && !deferShadow)
             {
-                Vector3 shadowOrig = intersectionPoint + normal * 0.001; // Offset simple
                 bool inShadow = isInShadow(shadowOrig, Ldir, Ldist);
 
                 if (inShadow) continue;
@@ -574,6 +862,14 @@ Vector3 Renderer::computeMicrofacetsLighting(const Vector3& P, const Vector3& v,
             // Atténuation par distance
             double attenDist = computeAttenuation(Ldist);
 
+            if (deferShadow)
+            {
+                deferredShadows->blocked.push(Ray(shadowOrig, Ldir, Scene::EPSILON, Ldist),
+                                              brdf * radiance * NdotL * attenDist / (double)numSamples,
+                                              deferredShadows->target);
+                continue;
+            }
+
             accumLight += brdf * radiance * NdotL * attenDist;
         }
 
@@ -583,12 +879,12 @@ Vector3 Renderer::computeMicrofacetsLighting(const Vector3& P, const Vector3& v,
     return result;
 }
 
-Vector3 Renderer::sampleMicrofacetsReflection(const Vector3& P, const Vector3& v,
-                                             const Vector3& intersectionPoint,
-                                             const Vector3& normal, const Shape& shape,
-                                             const int& order) const
+void Renderer::sampleMicrofacetsReflection(const Vector3& P, const Vector3& v,
+                                           const Vector3& intersectionPoint,
+                                           const Vector3& normal, const Intersection& hit,
+                                           SecondaryRays& secondaryRays, const double weight) const
 {
-    if (order <= 0) return Vector3(0, 0, 0);
+    const Shape& shape = *hit.shape;
 
     const Material& material = shape.getMaterial();
 
@@ -603,11 +899,10 @@ Vector3 Renderer::sampleMicrofacetsReflection(const Vector3& P, const Vector3& v
 
     // Vérifier que la direction est correcte
     if (reflectDir.dot(normal) <= 0.0) {
-        return Vector3(0, 0, 0);
+        return;
     }
 
-    Vector3 offset = reflectDir * computeCurvatureBias(shape, intersectionPoint, reflectDir, v);
-    Vector3 reflectedColor = getPixelColor(intersectionPoint + offset, reflectDir, order - 1);
+    Vector3 offset = reflectDir * computeCurvatureBias(hit, intersectionPoint, reflectDir, v);
 
     // Coefficient de réflexion basé sur Fresnel simple
     Vector3 viewDir = -v;
@@ -615,5 +910,5 @@ Vector3 Renderer::sampleMicrofacetsReflection(const Vector3& P, const Vector3& v
     Vector3 F0 = material.getF0();
     Vector3 F = F0 + (Vector3(1.0, 1.0, 1.0) - F0) * std::pow(1.0 - cosTheta, 5.0);
 
-    return reflectedColor * F;
+    secondaryRays.add(intersectionPoint + offset, reflectDir, F * weight);
 }
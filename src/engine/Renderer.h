@@ -2,16 +2,68 @@
 
 #include <vector>
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 #include "Camera.h"
-#include "acceleration/BVHNode.h"
+#include "acceleration/Accelerator.h"
+#include "acceleration/BVH.h"
 #include "Intersection.h"
+#include "RayQueue.h"
 #include "scenes/Scene.h"
 
 class Renderer
 {
+    // En dessous de ce seuil sur chaque canal, la lumière est considérée comme bloquée
+    static constexpr double SHADOW_ATTENUATION_CUTOFF = 1e-3;
+
+    // Nombre de rebonds (réflexion, réfraction) suivis depuis un rayon primaire
+    static constexpr int MAX_BOUNCES = 10;
+
+    // Côté des tuiles rendues d'un bloc par l'intégrateur wavefront : borne la taille des files
+    static constexpr int WAVEFRONT_TILE_SIZE = 256;
+
+    // Rayons tracés puis ombrés par une même tâche de l'intégrateur wavefront
+    static constexpr int WAVEFRONT_BATCH_SIZE = 256;
+
+    // Rayons d'une file wavefront traités d'un coup ; au-delà, le rebond suivant est
+    // tracé avant la suite de la file, ce qui borne la mémoire de chaque rebond
+    static constexpr size_t WAVEFRONT_MAX_QUEUE_SIZE = 16384;
+
+    // Poids composé (plus grand canal) en dessous duquel l'intégrateur wavefront
+    // abandonne un rayon secondaire : sans cela, chaque surface vitrée double les
+    // rayons d'une tuile à chaque rebond, alors que leurs contributions deviennent
+    // invisibles
+    static constexpr double WAVEFRONT_PATH_CUTOFF = 1e-3;
+
+    // Rayons réfléchis ou réfractés engendrés par une intersection (au plus un de
+    // chaque) : la couleur qu'ils voient compte pour weight dans celle du point touché
+    struct SecondaryRays {
+        struct Entry {
+            Vector3 origin;
+            Vector3 direction;
+            Vector3 weight;
+        };
+
+        Entry entries[2];
+        int count = 0;
+
+        void add(const Vector3& origin, const Vector3& direction, const Vector3& weight) {
+            entries[count++] = {origin, direction, weight};
+        }
+    };
+
+    // Rayons d'ombre reportés par l'intégrateur wavefront : la contribution d'un
+    // échantillon de lumière n'est ajoutée à la couleur du rayon target qu'après le
+    // tracé groupé de son rayon d'ombre
+    struct DeferredShadows {
+        RayQueue filtered; // Atténués par les objets transparents traversés (computeShadowAttenuation)
+        RayQueue blocked;  // Coupés par le premier obstacle (isInShadow)
+        uint32_t target = 0;
+    };
+
     Scene* scene;
-    BVHNode bvh_;
+    std::unique_ptr<Accelerator> accelerator_;
     Camera camera_;
 
 public:
@@ -25,10 +77,16 @@ public:
     bool specularEnabled = false;
     bool attenuationEnabled = false;
     bool textureEnabled = false;
+    // Rayons primaires tracés par paquets de 4, 8 ou 16 pixels voisins (1 : rayon par rayon)
+    int packetSize = 1;
+    // Intégrateur wavefront : au lieu de suivre chaque pixel récursivement, chaque rebond
+    // forme une file de rayons triée, tracée puis ombrée d'un bloc
+    bool wavefrontEnabled = false;
 
     explicit Renderer(Scene* scene, const Camera& camera, const int& width, const int& height) :
-        scene(scene), bvh_(scene->getShapes()), camera_(camera), width(width), height(height)
+        scene(scene), accelerator_(Accelerator::create(AcceleratorType::BVH, scene->getShapes())), camera_(camera), width(width), height(height)
     {
+        clearShapeChanges();
     };
 
     void render(std::vector<Vector3> &frameBuffer) const;
@@ -37,36 +95,91 @@ public:
 
     void setCamera(const Camera& camera);
 
+    const Accelerator& getAccelerator() const { return *accelerator_; }
+    AcceleratorType getAcceleratorType() const { return accelerator_->getType(); }
+
+    // Remplace la structure d'accélération de la scène par une structure du type
+    // demandé, construite immédiatement
+    void setAcceleratorType(AcceleratorType type);
+
+    // Reconstruit la structure d'accélération de la scène (niveau supérieur) : suffit
+    // après avoir déplacé une instance de mesh, dont le BVH propre n'est pas touché
+    void rebuildAccelerationStructure();
+
+    // Met à jour la structure d'accélération après déplacement de formes existantes
+    // (animation) : refit des boîtes du BVH, reconstruction seulement si l'arbre s'est
+    // trop dégradé ; la grille et l'arbre kd sont toujours reconstruits.
+    // Renvoie vrai si la structure a été reconstruite
+    bool refitAccelerationStructure(double rebuildThreshold = BVH::DEFAULT_REBUILD_THRESHOLD);
+
+    // Au-delà de ce nombre de formes modifiées depuis la dernière mise à jour, une
+    // reconstruction coûte moins que les modifications une à une (chacune est en O(N))
+    static constexpr size_t MAX_INCREMENTAL_EDITS = 32;
+
+    // Reporte dans la structure d'accélération les formes ajoutées ou retirées par
+    // Scene::addShape et Scene::removeShape, et celles dont la géométrie a changé
+    // (Shape::isBoundsDirty) : chacune est insérée ou retirée à sa place, sans
+    // reconstruction (édition interactive), sauf si la structure s'est trop dégradée
+    // depuis sa construction (Accelerator::needsRebuild). Renvoie vrai si elle a été reconstruite
+    bool syncAccelerationStructure();
+
 private:
+    // Oublie les modifications de la scène en attente, déjà prises en compte par une
+    // construction complète de la structure d'accélération
+    void clearShapeChanges();
+    // Rendu d'un bloc [bx, maxX[ x [by, maxY[ dont les rayons primaires sont tracés par paquets
+    void renderPackets(std::vector<Vector3>& frameBuffer, int bx, int by, int maxX, int maxY,
+                       const std::function<Vector3(int, int)>& primaryDirection) const;
+    // Rendu wavefront de la tuile [x0, x1[ x [y0, y1[
+    void renderWavefront(std::vector<Vector3>& frameBuffer, int x0, int y0, int x1, int y1,
+                         const std::function<Vector3(int, int)>& primaryDirection) const;
+    // Trace, ombre et accumule dans l'image les rayons de queue, au rebond order, puis
+    // leurs rayons secondaires par tranches d'au plus WAVEFRONT_MAX_QUEUE_SIZE
+    void traceWavefront(std::vector<Vector3>& frameBuffer, RayQueue& queue, int order,
+                        const AABB& sceneBounds) const;
+    // Trace les rayons d'ombre reportés d'un lot et ajoute à colors la lumière qui passe ;
+    // filtered : atténuation par les objets transparents, sinon visibilité tout ou rien
+    void traceShadowRays(const RayQueue& shadowRays, bool filtered, Vector3* colors) const;
     Vector3 getPixelColor(const Vector3& P, const Vector3& v, const int& order) const;
+    // Couleur vue par le rayon (P, v) dont l'intersection la plus proche est déjà connue
+    Vector3 shadeIntersection(const Vector3& P, const Vector3& v, const Intersection& result, const int& order) const;
+    // Éclairage direct au point touché ; les rayons réfléchis ou réfractés à suivre (si
+    // order > 0) sont ajoutés à secondaryRays au lieu d'être tracés
+    // Avec deferredShadows, les rayons d'ombre y sont ajoutés au lieu d'être tracés
+    Vector3 shadeSurface(const Vector3& P, const Vector3& v, const Intersection& result, const int& order,
+                         SecondaryRays& secondaryRays, DeferredShadows* deferredShadows = nullptr) const;
     Intersection findNearestIntersection(const Vector3& P, const Vector3& v) const;
-    Vector3 computeLighting(const Vector3& P, const Vector3& v, const Vector3& intersectionPoint, const Vector3& normal, const Shape& shape) const;
+    Vector3 computeLighting(const Vector3& P, const Vector3& v, const Vector3& intersectionPoint, const Vector3& normal, const Intersection& hit,
+                            DeferredShadows* deferredShadows = nullptr) const;
     bool isInShadow(const Vector3& shadowOrigin, const Vector3& shadowRayDir, double lightDistance) const;
     Vector3 computeShadowAttenuation(const Vector3& origin, const Vector3& dir, double lightDist) const;
     Vector3 computeDiffuse(const Vector3& intersectionPoint, const Vector3& normal, const Shape& shape, const LightSource& lightSource, const Vector3& shadowOrigin, const Vector3& shadowRayDir) const;
     Vector3 computeSpecular(const Vector3& P, const Vector3& v, const Vector3& intersectionPoint, const Vector3& normal, const Shape& shape, const LightSource& lightSource) const;
     double computeAttenuation(const double& distance) const;
     Vector3 perturbVector(const Vector3 &direction, const Vector3 &normal, double roughness) const;
-    double computeCurvatureBias(const Shape& shape, const Vector3& intersectionPoint, const Vector3& normal, const Vector3& rayDir) const;
+    double computeCurvatureBias(const Intersection& hit, const Vector3& intersectionPoint, const Vector3& normal, const Vector3& rayDir) const;
     std::pair<double, double> computeFresnelCoefficients(const Vector3& incident,
                                                         const Vector3& normal,
                                                         double etaI,
                                                         double etaT) const;
 
-    Vector3 computeReflection(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
-                             const Vector3 &normal, const Shape &shape, const int &order, double fresnelCoeff = 1.0) const;
+    void computeReflection(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
+                           const Vector3 &normal, const Intersection &hit, SecondaryRays &secondaryRays,
+                           double fresnelCoeff = 1.0) const;
 
-    Vector3 computeRefraction(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
-                             const Vector3 &normal, const Shape &shape, const int &order, double fresnelCoeff = 1.0) const;
+    void computeRefraction(const Vector3 &P, const Vector3 &v, const Vector3 &intersectionPoint,
+                           const Vector3 &normal, const Intersection &hit, SecondaryRays &secondaryRays,
+                           double fresnelCoeff = 1.0) const;
     Vector3 computeMicrofacetsBRDF(const Vector3& viewDir, const Vector3& lightDir,
                                   const Vector3& normal, const Material& material) const;
 
     Vector3 computeMicrofacetsLighting(const Vector3& P, const Vector3& v,
                                       const Vector3& intersectionPoint,
-                                      const Vector3& normal, const Shape& shape) const;
+                                      const Vector3& normal, const Shape& shape,
+                                      DeferredShadows* deferredShadows = nullptr) const;
 
-    Vector3 sampleMicrofacetsReflection(const Vector3& P, const Vector3& v,
-                                       const Vector3& intersectionPoint,
-                                       const Vector3& normal, const Shape& shape,
-                                       const int& order) const;
+    void sampleMicrofacetsReflection(const Vector3& P, const Vector3& v,
+                                     const Vector3& intersectionPoint,
+                                     const Vector3& normal, const Intersection& hit,
+                                     SecondaryRays& secondaryRays, double weight = 1.0) const;
 };
@@ -0,0 +1,102 @@
+#pragma once
+#include "Vector.h"
+#include <cmath>
+
+#ifdef _WIN32
+  #include <corecrt_math_defines.h>
+#endif
+
+/**
+ * @brief Affine transform (3x3 linear part + translation) with its cached inverse.
+ * Used to place a shared mesh in the scene: rays are brought into object space
+ * with the inverse, normals go back to world space with the inverse transpose.
+ */
+class Transform
+{
+    double m[3][3];     ///< Linear part
+    Vector3 t;          ///< Translation
+    double inv[3][3];   ///< Inverse of the linear part
+    Vector3 invT;       ///< Translation of the inverse transform
+
+public:
+    Transform() : m{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, t(0, 0, 0),
+                  inv{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, invT(0, 0, 0) {}
+
+    static Transform translate(const Vector3& offset) {
+        Transform tr;
+        tr.t = offset;
+        tr.invT = -offset;
+        return tr;
+    }
+
+    static Transform scale(const double s) {
+        Transform tr;
+        for (int i = 0; i < 3; ++i) {
+            tr.m[i][i] = s;
+            tr.inv[i][i] = 1.0 / s;
+        }
+        return tr;
+    }
+
+    /// Rotation of angleDegrees around axis (right-hand rule)
+    static Transform rotate(const double angleDegrees, const Vector3& axis) {
+        const Vector3 a = axis.normalized();
+        const double rad = angleDegrees * M_PI / 180.0;
+        const double c = std::cos(rad);
+        const double s = std::sin(rad);
+        const double k = 1.0 - c;
+
+        Transform tr;
+        const double r[3][3] = {
+            {a.x() * a.x() * k + c,         a.x() * a.y() * k - a.z() * s, a.x() * a.z() * k + a.y() * s},
+            {a.y() * a.x() * k + a.z() * s, a.y() * a.y() * k + c,         a.y() * a.z() * k - a.x() * s},
+            {a.z() * a.x() * k - a.y() * s, a.z() * a.y() * k + a.x() * s, a.z() * a.z() * k + c}
+        };
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                tr.m[i][j] = r[i][j];
+                tr.inv[j][i] = r[i][j]; // orthogonal: inverse = transpose
+            }
+        }
+        return tr;
+    }
+
+    /// Composition: (*this * other)(p) = this(other(p))
+    Transform operator*(const Transform& other) const {
+        Transform tr;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                tr.m[i][j] = m[i][0] * other.m[0][j] + m[i][1] * other.m[1][j] + m[i][2] * other.m[2][j];
+                tr.inv[i][j] = other.inv[i][0] * inv[0][j] + other.inv[i][1] * inv[1][j] + other.inv[i][2] * inv[2][j];
+            }
+        }
+        tr.t = applyToPoint(other.t);
+        tr.invT = other.applyInverseToPoint(invT);
+        return tr;
+    }
+
+    Vector3 applyToVector(const Vector3& v) const { return multiply(m, v); }
+    Vector3 applyToPoint(const Vector3& p) const { return multiply(m, p) + t; }
+    Vector3 applyInverseToVector(const Vector3& v) const { return multiply(inv, v); }
+    Vector3 applyInverseToPoint(const Vector3& p) const { return multiply(inv, p) + invT; }
+
+    /// Normals transform with the inverse transpose (result is not normalized)
+    Vector3 applyToNormal(const Vector3& n) const {
+        return Vector3{
+            inv[0][0] * n[0] + inv[1][0] * n[1] + inv[2][0] * n[2],
+            inv[0][1] * n[0] + inv[1][1] * n[1] + inv[2][1] * n[2],
+            inv[0][2] * n[0] + inv[1][2] * n[1] + inv[2][2] * n[2]
+        };
+    }
+
+    const Vector3& getTranslation() const { return t; }
+
+private:
+    static Vector3 multiply(const double a[3][3], const Vector3& v) {
+        return Vector3{
+            a[0][0] * v[0] + a[0][1] * v[1] + a[0][2] * v[2],
+            a[1][0] * v[0] + a[1][1] * v[1] + a[1][2] * v[2],
+            a[2][0] * v[0] + a[2][1] * v[1] + a[2][2] * v[2]
+        };
+    }
+};
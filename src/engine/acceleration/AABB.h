@@ -0,0 +1,84 @@
+#pragma once
+
+#include <limits>
+#include "../Vector.h"
+#include "../Ray.h"
+
+/**
+ * Boîte englobante alignée sur les axes, simple valeur stockée en place dans les
+ * formes et les nœuds du BVH, sans allocation ni table virtuelle.
+ * La boîte par défaut est vide (minima à +inf, maxima à -inf) : l'agrandir d'une
+ * autre boîte ou d'un point redonne exactement celle-ci.
+ */
+struct AABB {
+    Vector3 min = Vector3(std::numeric_limits<double>::infinity(),
+                          std::numeric_limits<double>::infinity(),
+                          std::numeric_limits<double>::infinity());
+    Vector3 max = Vector3(-std::numeric_limits<double>::infinity(),
+                          -std::numeric_limits<double>::infinity(),
+                          -std::numeric_limits<double>::infinity());
+
+    AABB() = default;
+    AABB(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+
+    bool isEmpty() const { return min.x() > max.x() || min.y() > max.y() || min.z() > max.z(); }
+
+    Vector3 getCenter() const { return (min + max) * 0.5; }
+    Vector3 getExtent() const { return max - min; }
+
+    // Aire de la surface de la boîte (utilisée par le SAH)
+    double getSurfaceArea() const {
+        const Vector3 d = max - min;
+        return 2.0 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    // Axe de plus grande étendue
+    int getLongestAxis() const {
+        const Vector3 d = max - min;
+        return (d[0] > d[1]) ? (d[0] > d[2] ? 0 : 2) : (d[1] > d[2] ? 1 : 2);
+    }
+
+    void grow(const Vector3& point) {
+        min = min.min(point);
+        max = max.max(point);
+    }
+
+    void grow(const AABB& other) {
+        min = min.min(other.min);
+        max = max.max(other.max);
+    }
+
+    static AABB merge(const AABB& a, const AABB& b) {
+        return AABB(a.min.min(b.min), a.max.max(b.max));
+    }
+
+    bool contains(const Vector3& P) const {
+        return (P.x() >= min.x() && P.x() <= max.x()) &&
+               (P.y() >= min.y() && P.y() <= max.y()) &&
+               (P.z() >= min.z() && P.z() <= max.z());
+    }
+
+    // Test rayon/boîte par la méthode des slabs, sans branche : le signe de la direction
+    // désigne les plans d'entrée et de sortie, les NaN (0 * inf) sont écartés par l'ordre
+    // des comparaisons et la sortie est élargie de Ray::FAR_SCALE contre les arrondis.
+    // tEntry et tExit reçoivent les distances d'entrée et de sortie, limitées à [ray.tMin, ray.tMax]
+    bool intersect(const Ray& ray, double& tEntry, double& tExit) const {
+        const Vector3* planes[2] = {&min, &max};
+        double t0 = ray.tMin;
+        double t1 = ray.tMax;
+        for (int i = 0; i < 3; ++i) {
+            const double tNear = ((*planes[ray.sign[i]])[i] - ray.origin[i]) * ray.invDirection[i];
+            const double tFar = ((*planes[1 - ray.sign[i]])[i] - ray.origin[i]) * ray.invDirection[i] * Ray::FAR_SCALE;
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+        }
+        tEntry = t0;
+        tExit = t1;
+        return t0 <= t1;
+    }
+
+    bool intersect(const Ray& ray, double& tEntry) const {
+        double tExit;
+        return intersect(ray, tEntry, tExit);
+    }
+};
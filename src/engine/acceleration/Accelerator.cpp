@@ -0,0 +1,91 @@
+#include "Accelerator.h"
+#include "BVH.h"
+#include "KdTree.h"
+#include "UniformGrid.h"
+#include <algorithm>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+std::unique_ptr<Accelerator> Accelerator::create(const AcceleratorType type,
+                                                 const std::vector<std::shared_ptr<Shape>>& shapes) {
+    switch (type) {
+        case AcceleratorType::Grid:
+            return std::make_unique<UniformGrid>(shapes);
+        case AcceleratorType::KdTree:
+            return std::make_unique<KdTree>(shapes);
+        case AcceleratorType::BVH:
+        default:
+            return std::make_unique<BVH>(shapes);
+    }
+}
+
+void Accelerator::getIntersections(const Ray* rays, const int count, Intersection* hits) const {
+    for (int i = 0; i < count; ++i) {
+        hits[i] = getIntersection(rays[i]);
+    }
+}
+
+double Accelerator::getBoundsMargin(const AABB& bounds) {
+    const Vector3 extent = bounds.getExtent();
+    return std::max({extent.x(), extent.y(), extent.z(), 1.0}) * BOUNDS_MARGIN;
+}
+
+void Accelerator::updateBoundingBoxes(const std::vector<std::shared_ptr<Shape>>& shapes) {
+#ifdef USE_TBB
+    tbb::parallel_for(size_t(0), shapes.size(), [&](const size_t i) {
+        shapes[i]->setBoundingBox();
+    });
+#else
+    for (const auto& shape : shapes) {
+        shape->setBoundingBox();
+    }
+#endif
+}
+
+std::vector<std::shared_ptr<Shape>> Accelerator::partitionShapes(const std::vector<std::shared_ptr<Shape>>& shapes) {
+    std::vector<std::shared_ptr<Shape>> boundedShapes;
+    boundedShapes.reserve(shapes.size());
+    unboundedPrimitives.clear();
+    for (const auto& shape : shapes) {
+        if (shape->isBounded()) {
+            boundedShapes.push_back(shape);
+        } else {
+            unboundedPrimitives.push_back(shape);
+        }
+    }
+
+    updateBoundingBoxes(boundedShapes);
+    return boundedShapes;
+}
+
+Intersection Accelerator::intersectUnbounded(const Ray& ray, double& tMax) const {
+    Intersection closest;
+    for (const auto& shape : unboundedPrimitives) {
+        const Intersection inter = shape->getIntersection(ray.origin, ray.direction, ray.tMin, tMax);
+        if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+            closest = inter;
+            tMax = inter.lambda;
+        }
+    }
+    return closest;
+}
+
+bool Accelerator::unboundedOccluded(const Ray& ray) const {
+    for (const auto& shape : unboundedPrimitives) {
+        if (shape->hasIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Accelerator::forEachUnboundedHit(const Ray& ray, const IntersectionCallback& callback) const {
+    for (const auto& shape : unboundedPrimitives) {
+        if (!shape->forEachIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax, callback)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "AABB.h"
+#include "../Ray.h"
+#include "../Intersection.h"
+#include "../shapes/Shape.h"
+
+/**
+ * Structure d'accélération utilisée par le rendu pour la scène.
+ */
+enum class AcceleratorType {
+    BVH,   ///< Hiérarchie de boîtes englobantes (voir BVH)
+    Grid,  ///< Grille uniforme parcourue par 3D-DDA (voir UniformGrid)
+    KdTree ///< Arbre kd construit par SAH (voir KdTree)
+};
+
+/**
+ * Statistiques communes à toutes les structures d'accélération.
+ */
+struct AcceleratorStats {
+    size_t nodeCount = 0;      ///< Nœuds de l'arbre, ou cellules de la grille
+    size_t leafCount = 0;      ///< Feuilles, ou cellules non vides de la grille
+    size_t primitiveCount = 0; ///< Références de primitives stockées, doublons compris
+    size_t unboundedCount = 0; ///< Primitives infinies testées hors de la structure
+    size_t bytes = 0;          ///< Mémoire des nœuds ou des cellules
+    double buildMilliseconds = 0.0; ///< Durée de construction
+
+    double bytesPerNode() const { return nodeCount ? static_cast<double>(bytes) / nodeCount : 0.0; }
+};
+
+/**
+ * Interface des structures d'accélération : requêtes du plus proche, any-hit et
+ * all-hits sur les formes de la scène. La construction se fait à la création,
+ * par create() ou directement par le constructeur de l'implémentation.
+ * Toutes les implémentations gardent les primitives non bornées (plans) à part
+ * et les testent à chaque requête. insert() et remove() modifient la structure
+ * en place ; une forme déplacée est retirée puis insérée à nouveau.
+ */
+class Accelerator {
+public:
+    virtual ~Accelerator() = default;
+
+    // Construit la structure du type demandé sur les formes de la scène
+    static std::unique_ptr<Accelerator> create(AcceleratorType type,
+                                               const std::vector<std::shared_ptr<Shape>>& shapes);
+
+    virtual AcceleratorType getType() const = 0;
+    virtual const char* getName() const = 0;
+
+    // Intersection la plus proche du rayon dans l'intervalle [ray.tMin, ray.tMax[
+    virtual Intersection getIntersection(const Ray& ray) const = 0;
+
+    // Intersections les plus proches de count rayons : hits[i] reçoit le même résultat
+    // que getIntersection(rays[i]). Par défaut les rayons sont tracés un par un
+    virtual void getIntersections(const Ray* rays, int count, Intersection* hits) const;
+
+    // Requête any-hit : vrai dès qu'une primitive coupe le rayon dans [ray.tMin, ray.tMax[
+    virtual bool occluded(const Ray& ray) const = 0;
+
+    // Requête all-hits : appelle callback une seule fois par intersection dans
+    // [ray.tMin, ray.tMax[. Renvoie false si callback a interrompu le parcours.
+    // Une primitive référencée par plusieurs cellules ou feuilles n'y est testée que
+    // sur l'intervalle de chacune : chaque intersection n'est rapportée que par celle
+    // qui la contient et n'est donc pas comptée plusieurs fois
+    virtual bool forEachHit(const Ray& ray, const IntersectionCallback& callback) const = 0;
+
+    // Mise à jour après déplacement des formes. Renvoie vrai si la structure a été
+    // reconstruite entièrement plutôt qu'ajustée
+    virtual bool update(double rebuildThreshold) = 0;
+
+    // Ajout d'une forme à la structure existante (édition interactive), sans
+    // reconstruction quand l'implémentation le permet
+    virtual void insert(const std::shared_ptr<Shape>& shape) = 0;
+
+    // Retrait d'une forme. Renvoie false si elle n'était pas dans la structure
+    virtual bool remove(const std::shared_ptr<Shape>& shape) = 0;
+
+    // Vrai si les modifications en place ont assez dégradé la structure pour qu'une
+    // reconstruction complète soit rentable (seuil au sens de update)
+    virtual bool needsRebuild(double rebuildThreshold) const = 0;
+
+    virtual AABB getBounds() const = 0;
+    virtual const AcceleratorStats& getStats() const = 0;
+
+protected:
+    // Marge relative ajoutée à la boîte de la scène et à celles des primitives : une
+    // primitive posée sur la limite de deux cellules, ou sur un plan de découpe, est
+    // référencée des deux côtés, et une scène plate garde une épaisseur non nulle
+    static constexpr double BOUNDS_MARGIN = 1e-7;
+
+    // Marge absolue correspondant à BOUNDS_MARGIN pour une scène de boîte bounds
+    static double getBoundsMargin(const AABB& bounds);
+
+    // Recalcule la boîte de chaque forme, en parallèle avec TBB
+    static void updateBoundingBoxes(const std::vector<std::shared_ptr<Shape>>& shapes);
+
+    // Range les formes non bornées de shapes dans unboundedPrimitives et renvoie les
+    // autres, dont les boîtes sont calculées une seule fois : la construction ne fait
+    // ensuite que les lire
+    std::vector<std::shared_ptr<Shape>> partitionShapes(const std::vector<std::shared_ptr<Shape>>& shapes);
+
+    // Requêtes sur les primitives non bornées, faites avant le parcours de la structure.
+    // intersectUnbounded renvoie la plus proche dans [ray.tMin, tMax[ et y ramène tMax
+    Intersection intersectUnbounded(const Ray& ray, double& tMax) const;
+    bool unboundedOccluded(const Ray& ray) const;
+    bool forEachUnboundedHit(const Ray& ray, const IntersectionCallback& callback) const;
+
+    std::vector<std::shared_ptr<Shape>> unboundedPrimitives;
+};
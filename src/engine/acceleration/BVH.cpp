@@ -0,0 +1,1625 @@
+#include "BVH.h"
+#include "LBVHBuilder.h"
+#include "SBVHBuilder.h"
+#include "../scenes/Scene.h"
+#include "../shapes/Mesh.h"
+#include <limits>
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Taille approximative du bloc de contrôle d'un std::make_shared (compteurs + vtable)
+    constexpr size_t SHARED_CONTROL_BLOCK_BYTES = 2 * sizeof(int) + sizeof(void*);
+
+    // Profondeur maximale de la pile de parcours : le SAH est borné à
+    // BVHNode::MAX_SAH_DEPTH niveaux, la médiane ajoute au plus 32 niveaux.
+    // Les insertions, elles, ne sont bornées que par MAX_EDITED_DEPTH
+    constexpr int STACK_SIZE = 128;
+
+    // Un parcours empile au plus une entrée de plus par niveau descendu : au-delà de
+    // cette profondeur de feuille, une insertion reconstruit l'arbre plutôt que de
+    // risquer de déborder la pile
+    constexpr int MAX_EDITED_DEPTH = STACK_SIZE - 2;
+
+    // Demande le chargement en cache des size octets à partir de address, sans attendre
+    void prefetch(const void* address, const size_t size) {
+        const char* bytes = static_cast<const char*>(address);
+        for (size_t offset = 0; offset < size; offset += 64) {
+#ifdef _MSC_VER
+            _mm_prefetch(bytes + offset, _MM_HINT_T0);
+#else
+            __builtin_prefetch(bytes + offset);
+#endif
+        }
+    }
+
+    // Test rayon/boîte par la méthode des slabs, sans branche : le signe de la direction
+    // désigne directement le plan d'entrée et le plan de sortie de chaque slab, et l'ordre
+    // des comparaisons écarte les NaN (0 * inf, origine sur le plan d'une direction
+    // parallèle). La sortie est élargie de Ray::FAR_SCALE pour qu'un arrondi ne rejette
+    // jamais une boîte effleurée. tEntry reçoit la distance d'entrée, limitée à [ray.tMin, tMax]
+    bool intersectSlabs(const double* lo, const double* hi, const Ray& ray, const double tMax, double& tEntry) {
+        const double* planes[2] = {lo, hi};
+        double t0 = ray.tMin;
+        double t1 = tMax;
+        for (int i = 0; i < 3; ++i) {
+            const double tNear = (planes[ray.sign[i]][i] - ray.origin[i]) * ray.invDirection[i];
+            const double tFar = (planes[1 - ray.sign[i]][i] - ray.origin[i]) * ray.invDirection[i] * Ray::FAR_SCALE;
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+        }
+        tEntry = t0;
+        return t0 <= t1;
+    }
+
+    bool intersectBox(const LinearBVHNode& node, const Ray& ray, const double tMax, double& tEntry) {
+        return intersectSlabs(node.min, node.max, ray, tMax, tEntry);
+    }
+
+    // Même test sur une boîte rangée minima puis maxima
+    bool intersectBounds(const double box[6], const Ray& ray, const double tMax, double& tEntry) {
+        return intersectSlabs(box, box + 3, ray, tMax, tEntry);
+    }
+
+    // Paquet de rayons rangé par composante (SoA) pour tester une boîte contre quatre
+    // rayons par instruction. Les places au-delà de count ont un intervalle vide
+    struct PacketRays {
+        alignas(32) double origin[3][BVH::MAX_PACKET_SIZE];
+        alignas(32) double invDir[3][BVH::MAX_PACKET_SIZE];
+        alignas(32) double tMin[BVH::MAX_PACKET_SIZE];
+        alignas(32) double tMax[BVH::MAX_PACKET_SIZE];
+        int count = 0;
+        int sign[3] = {0, 0, 0};
+
+        // Frustum du paquet : intervalles des origines et des inverses de direction,
+        // utilisables seulement si toutes les composantes de direction sont non nulles
+        double originLo[3], originHi[3];
+        double invDirLo[3], invDirHi[3];
+        bool hasFrustum = true;
+
+        // Faux si les directions n'ont pas toutes le même signe sur chaque axe :
+        // les plans d'entrée et de sortie ne sont alors plus communs au paquet
+        bool load(const Ray* rays, const int rayCount) {
+            count = rayCount;
+            for (int a = 0; a < 3; ++a) {
+                sign[a] = rays[0].sign[a];
+                originLo[a] = invDirLo[a] = INF;
+                originHi[a] = invDirHi[a] = -INF;
+            }
+            for (int i = 0; i < BVH::MAX_PACKET_SIZE; ++i) {
+                const bool used = i < rayCount;
+                for (int a = 0; a < 3; ++a) {
+                    origin[a][i] = used ? rays[i].origin[a] : 0.0;
+                    invDir[a][i] = used ? rays[i].invDirection[a] : 0.0;
+                    if (!used) continue;
+                    if (rays[i].sign[a] != sign[a]) return false;
+                    if (!std::isfinite(invDir[a][i])) hasFrustum = false;
+                    originLo[a] = std::min(originLo[a], origin[a][i]);
+                    originHi[a] = std::max(originHi[a], origin[a][i]);
+                    invDirLo[a] = std::min(invDirLo[a], invDir[a][i]);
+                    invDirHi[a] = std::max(invDirHi[a], invDir[a][i]);
+                }
+                tMin[i] = used ? rays[i].tMin : 1.0;
+                tMax[i] = used ? rays[i].tMax : 0.0;
+            }
+            return true;
+        }
+    };
+
+    // Vrai si aucun rayon du paquet ne peut toucher la boîte avant tMax : arithmétique
+    // d'intervalles sur les origines et les inverses de direction, arrondie dans le
+    // sens prudent comme le test d'un rayon seul
+    bool frustumMisses(const LinearBVHNode& node, const PacketRays& packet, const double tMin, const double tMax) {
+        const double* planes[2] = {node.min, node.max};
+        double t0 = tMin;
+        double t1 = tMax;
+        for (int a = 0; a < 3; ++a) {
+            const double nearPlane = planes[packet.sign[a]][a];
+            const double farPlane = planes[1 - packet.sign[a]][a];
+            const double nearLo = nearPlane - packet.originHi[a];
+            const double nearHi = nearPlane - packet.originLo[a];
+            const double farLo = farPlane - packet.originHi[a];
+            const double farHi = farPlane - packet.originLo[a];
+            const double tNear = std::min(std::min(nearLo * packet.invDirLo[a], nearLo * packet.invDirHi[a]),
+                                          std::min(nearHi * packet.invDirLo[a], nearHi * packet.invDirHi[a]));
+            const double tFar = std::max(std::max(farLo * packet.invDirLo[a], farLo * packet.invDirHi[a]),
+                                         std::max(farHi * packet.invDirLo[a], farHi * packet.invDirHi[a])) * Ray::FAR_SCALE;
+            t0 = std::max(t0, tNear);
+            t1 = std::min(t1, tFar);
+        }
+        return t0 > t1;
+    }
+
+    // Test de la boîte d'un nœud pour les rayons actifs du paquet, quatre rayons par
+    // instruction avec AVX. Renvoie le masque des rayons qui la touchent
+    uint32_t intersectPacket(const LinearBVHNode& node, const PacketRays& packet, const uint32_t active) {
+        const double* planes[2] = {node.min, node.max};
+        uint32_t mask = 0;
+#ifdef __AVX__
+        const __m256d farScale = _mm256_set1_pd(Ray::FAR_SCALE);
+        for (int g = 0; g < packet.count; g += 4) {
+            if (!((active >> g) & 0xF)) continue;
+            __m256d t0 = _mm256_load_pd(&packet.tMin[g]);
+            __m256d t1 = _mm256_load_pd(&packet.tMax[g]);
+            for (int a = 0; a < 3; ++a) {
+                const __m256d origin = _mm256_load_pd(&packet.origin[a][g]);
+                const __m256d invDir = _mm256_load_pd(&packet.invDir[a][g]);
+                const __m256d nearPlane = _mm256_set1_pd(planes[packet.sign[a]][a]);
+                const __m256d farPlane = _mm256_set1_pd(planes[1 - packet.sign[a]][a]);
+                const __m256d tNear = _mm256_mul_pd(_mm256_sub_pd(nearPlane, origin), invDir);
+                const __m256d tFar = _mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(farPlane, origin), invDir), farScale);
+                // max/min renvoient leur second opérande sur un NaN (0 * inf) : l'axe est alors ignoré
+                t0 = _mm256_max_pd(tNear, t0);
+                t1 = _mm256_min_pd(tFar, t1);
+            }
+            mask |= static_cast<uint32_t>(_mm256_movemask_pd(_mm256_cmp_pd(t0, t1, _CMP_LE_OQ))) << g;
+        }
+#else
+        for (int i = 0; i < packet.count; ++i) {
+            if (!(active & (1u << i))) continue;
+            double t0 = packet.tMin[i];
+            double t1 = packet.tMax[i];
+            for (int a = 0; a < 3; ++a) {
+                const double tNear = (planes[packet.sign[a]][a] - packet.origin[a][i]) * packet.invDir[a][i];
+                const double tFar = (planes[1 - packet.sign[a]][a] - packet.origin[a][i]) * packet.invDir[a][i] * Ray::FAR_SCALE;
+                t0 = tNear > t0 ? tNear : t0;
+                t1 = tFar < t1 ? tFar : t1;
+            }
+            if (t0 <= t1) mask |= 1u << i;
+        }
+#endif
+        return mask & active;
+    }
+
+    struct PacketStackEntry {
+        uint32_t node;
+        uint32_t active; ///< Rayons du paquet qui touchent la boîte du nœud
+    };
+
+    struct StackEntry {
+        uint32_t node;
+        double tEntry; ///< Distance d'entrée dans la boîte du nœud
+    };
+
+    // Une entrée du parcours quantifié emporte la boîte décodée du nœud,
+    // nécessaire pour décoder celles de ses enfants
+    struct QuantizedStackEntry {
+        uint32_t index;          ///< Nœud quantifié, ou première primitive d'une feuille
+        uint16_t primitiveCount; ///< 0 pour un nœud interne
+        double tEntry;
+        double box[6];
+    };
+
+    // Pas de quantification de [lo, hi] : une multiplication plutôt qu'une division,
+    // l'encodage et le parcours partageant la même expression
+    template <typename T>
+    double quantizationStep(const double lo, const double hi) {
+        constexpr double inverseMax = 1.0 / QuantizedBVHNode<T>::MAX_VALUE;
+        return (hi - lo) * inverseMax;
+    }
+
+    // Décodage d'une borne quantifiée q sur [lo, hi], découpé en pas de step.
+    // std::fma donne le même arrondi à l'encodage et au parcours, quelles que
+    // soient les contractions choisies par le compilateur. Le maximum décode
+    // exactement hi pour que la boîte du parent reste atteignable
+    template <typename T>
+    double dequantizeMin(const int q, const double lo, const double step) {
+        return std::fma(static_cast<double>(q), step, lo);
+    }
+
+    template <typename T>
+    double dequantizeMax(const int q, const double lo, const double hi, const double step) {
+        return q == QuantizedBVHNode<T>::MAX_VALUE ? hi : std::fma(static_cast<double>(q), step, lo);
+    }
+
+    // Plus grande valeur dont le décodage reste inférieur ou égal à x
+    template <typename T>
+    T quantizeMin(const double x, const double lo, const double step) {
+        constexpr int maxValue = QuantizedBVHNode<T>::MAX_VALUE;
+        int q = step > 0.0 ? static_cast<int>(std::clamp(std::floor((x - lo) / step), 0.0, double(maxValue))) : 0;
+        while (q > 0 && dequantizeMin<T>(q, lo, step) > x) --q;
+        return static_cast<T>(q);
+    }
+
+    // Plus petite valeur dont le décodage reste supérieur ou égal à x
+    template <typename T>
+    T quantizeMax(const double x, const double lo, const double hi, const double step) {
+        constexpr int maxValue = QuantizedBVHNode<T>::MAX_VALUE;
+        int q = step > 0.0 ? static_cast<int>(std::clamp(std::ceil((x - lo) / step), 0.0, double(maxValue))) : maxValue;
+        while (q < maxValue && dequantizeMax<T>(q, lo, hi, step) < x) ++q;
+        return static_cast<T>(q);
+    }
+
+    // Boîtes des deux enfants d'un nœud quantifié dont la boîte décodée est box
+    template <typename T>
+    void decodeChildren(const QuantizedBVHNode<T>& node, const double box[6], double childBox[2][6]) {
+        for (int a = 0; a < 3; ++a) {
+            const double lo = box[a];
+            const double hi = box[3 + a];
+            const double step = quantizationStep<T>(lo, hi);
+            for (int c = 0; c < 2; ++c) {
+                childBox[c][a] = dequantizeMin<T>(node.bounds[a][c], lo, step);
+                childBox[c][3 + a] = dequantizeMax<T>(node.bounds[3 + a][c], lo, hi, step);
+            }
+        }
+    }
+
+    // Entrée de la racine : la seule boîte stockée en double précision
+    QuantizedStackEntry rootEntry(const LinearBVHNode& root, const double tEntry) {
+        QuantizedStackEntry entry;
+        entry.index = root.primitiveCount > 0 ? root.primitivesOffset : 0;
+        entry.primitiveCount = root.primitiveCount;
+        entry.tEntry = tEntry;
+        for (int a = 0; a < 3; ++a) {
+            entry.box[a] = root.min[a];
+            entry.box[3 + a] = root.max[a];
+        }
+        return entry;
+    }
+
+    QuantizedStackEntry childEntry(uint32_t index, uint16_t primitiveCount, double tEntry, const double box[6]) {
+        QuantizedStackEntry entry;
+        entry.index = index;
+        entry.primitiveCount = primitiveCount;
+        entry.tEntry = tEntry;
+        std::copy(box, box + 6, entry.box);
+        return entry;
+    }
+
+    // Rayon préparé pour le test des enfants d'un nœud large : lignes de bornes
+    // d'entrée et de sortie choisies d'après le signe de la direction, origine et
+    // inverse de la direction diffusés une fois par requête dans des registres AVX
+    struct WideRay {
+        double origin[3];
+        double invDir[3];
+        int nearRow[3];
+        int farRow[3];
+        double tMin;
+#ifdef __AVX__
+        __m256d originV[3];
+        __m256d invDirV[3];
+#endif
+
+        explicit WideRay(const Ray& ray) : tMin(ray.tMin) {
+            for (int i = 0; i < 3; ++i) {
+                origin[i] = ray.origin[i];
+                invDir[i] = ray.invDirection[i];
+                nearRow[i] = ray.sign[i] ? 3 + i : i;
+                farRow[i] = ray.sign[i] ? i : 3 + i;
+#ifdef __AVX__
+                originV[i] = _mm256_set1_pd(ray.origin[i]);
+                invDirV[i] = _mm256_set1_pd(ray.invDirection[i]);
+#endif
+            }
+        }
+    };
+
+    // Test des N boîtes enfants d'un nœud large par la méthode des slabs, quatre
+    // enfants par instruction avec AVX. Renvoie le masque des enfants touchés dans
+    // [ray.tMin, tMax] et écrit leurs distances d'entrée dans tNear
+    template <int N>
+    int intersectChildren(const WideBVHNode<N>& node, const WideRay& ray, const double tMax, double* tNear) {
+        int mask = 0;
+#ifdef __AVX__
+        const __m256d start = _mm256_set1_pd(ray.tMin);
+        const __m256d limit = _mm256_set1_pd(tMax);
+        const __m256d farScale = _mm256_set1_pd(Ray::FAR_SCALE);
+        for (int g = 0; g < N; g += 4) {
+            __m256d t0 = start;
+            __m256d t1 = limit;
+            for (int a = 0; a < 3; ++a) {
+                const __m256d lo = _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(&node.bounds[ray.nearRow[a]][g]), ray.originV[a]), ray.invDirV[a]);
+                const __m256d hi = _mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(&node.bounds[ray.farRow[a]][g]), ray.originV[a]), ray.invDirV[a]), farScale);
+                // max/min renvoient leur second opérande sur un NaN (0 * inf) : l'axe est alors ignoré
+                t0 = _mm256_max_pd(lo, t0);
+                t1 = _mm256_min_pd(hi, t1);
+            }
+            _mm256_storeu_pd(&tNear[g], t0);
+            mask |= _mm256_movemask_pd(_mm256_cmp_pd(t0, t1, _CMP_LE_OQ)) << g;
+        }
+#else
+        for (int i = 0; i < N; ++i) {
+            double t0 = ray.tMin;
+            double t1 = tMax;
+            for (int a = 0; a < 3; ++a) {
+                const double lo = (node.bounds[ray.nearRow[a]][i] - ray.origin[a]) * ray.invDir[a];
+                const double hi = (node.bounds[ray.farRow[a]][i] - ray.origin[a]) * ray.invDir[a] * Ray::FAR_SCALE;
+                t0 = lo > t0 ? lo : t0;
+                t1 = hi < t1 ? hi : t1;
+            }
+            tNear[i] = t0;
+            if (t0 <= t1) mask |= 1 << i;
+        }
+#endif
+        return mask & node.validMask;
+    }
+
+    struct WideStackEntry {
+        uint32_t index;          ///< Nœud large, ou premier indice de primitive pour une feuille
+        uint16_t primitiveCount; ///< 0 pour un nœud interne
+        double tEntry;
+    };
+
+    // Primitives déjà rapportées par une requête all-hits : avec des découpes
+    // spatiales, une même primitive peut figurer dans plusieurs feuilles
+    class VisitedPrimitives {
+    public:
+        explicit VisitedPrimitives(const bool enabled) : enabled(enabled) {}
+
+        // Vrai la première fois que la primitive d'identifiant id est rencontrée
+        bool firstVisit(const uintptr_t id) {
+            if (!enabled) return true;
+            if (std::find(visited.begin(), visited.end(), id) != visited.end()) return false;
+            visited.push_back(id);
+            return true;
+        }
+
+    private:
+        bool enabled;
+        std::vector<uintptr_t> visited;
+    };
+
+    double surfaceArea(const LinearBVHNode& node) {
+        const double dx = node.max[0] - node.min[0];
+        const double dy = node.max[1] - node.min[1];
+        const double dz = node.max[2] - node.min[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    // Aire de la réunion de la boîte du nœud et de box
+    double unionArea(const LinearBVHNode& node, const AABB& box) {
+        double d[3];
+        for (int a = 0; a < 3; ++a) {
+            d[a] = std::max(node.max[a], box.max[a]) - std::min(node.min[a], box.min[a]);
+        }
+        return 2.0 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+    }
+}
+
+BVH::BVH(const std::vector<std::shared_ptr<Shape>>& shapes, const BVHBuildOptions& options)
+    : options(options)
+{
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::shared_ptr<Shape>> boundedShapes = partitionShapes(shapes);
+    stats.unboundedCount = unboundedPrimitives.size();
+
+    if (boundedShapes.empty()) {
+        return;
+    }
+
+    const bool linearBuild = options.splitMethod == BVHSplitMethod::LBVH
+        || options.splitMethod == BVHSplitMethod::HLBVH;
+    std::shared_ptr<BVHNode> root;
+    if (linearBuild) {
+        root = LBVHBuilder::build(boundedShapes, options);
+    } else if (options.splitMethod == BVHSplitMethod::SBVH) {
+        root = SBVHBuilder::build(boundedShapes, options);
+    } else {
+        root = std::make_shared<BVHNode>(boundedShapes, 0, boundedShapes.size(), options);
+    }
+    nodes.reserve(2 * boundedShapes.size() - 1);
+    primitives.reserve(boundedShapes.size());
+    flatten(*root);
+
+    stats.nodeCount = nodes.size();
+    stats.primitiveCount = primitives.size();
+    stats.duplicateCount = primitives.size() - boundedShapes.size();
+    stats.bytes = nodes.size() * sizeof(LinearBVHNode);
+    stats.maxDepth = computeMaxDepth();
+
+    buildLayoutNodes();
+    stats.builtSAHCost = getSAHCost();
+
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    stats.buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+}
+
+BVH::BVH(std::vector<LinearBVHNode> nodes, std::vector<std::shared_ptr<Shape>> primitives,
+         const BVHBuildOptions& options)
+    : nodes(std::move(nodes)), primitives(std::move(primitives)), options(options)
+{
+    std::vector<const Shape*> unique;
+    unique.reserve(this->primitives.size());
+    for (const auto& shape : this->primitives) unique.push_back(shape.get());
+    std::sort(unique.begin(), unique.end());
+    initLoadedTree(static_cast<size_t>(std::unique(unique.begin(), unique.end()) - unique.begin()));
+}
+
+BVH::BVH(std::vector<LinearBVHNode> nodes, std::vector<uint32_t> triangleIndices, const Mesh& mesh,
+         const BVHBuildOptions& options)
+    : nodes(std::move(nodes)), mesh(&mesh), triangleIndices(std::move(triangleIndices)), options(options)
+{
+    std::vector<uint32_t> unique = this->triangleIndices;
+    std::sort(unique.begin(), unique.end());
+    initLoadedTree(static_cast<size_t>(std::unique(unique.begin(), unique.end()) - unique.begin()));
+}
+
+void BVH::initLoadedTree(const size_t uniqueCount) {
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+
+    for (const LinearBVHNode& node : nodes) {
+        stats.pointerTreeBytes += sizeof(BVHNode) + SHARED_CONTROL_BLOCK_BYTES;
+        if (node.primitiveCount > 0) {
+            stats.leafCount++;
+        }
+    }
+    stats.nodeCount = nodes.size();
+    stats.primitiveCount = mesh ? triangleIndices.size() : primitives.size();
+    stats.duplicateCount = stats.primitiveCount - uniqueCount;
+    stats.bytes = nodes.size() * sizeof(LinearBVHNode);
+    stats.maxDepth = computeMaxDepth();
+
+    buildLayoutNodes();
+    stats.builtSAHCost = getSAHCost();
+
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    stats.buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+}
+
+Intersection BVH::intersectPrimitive(const uint32_t reference, const Ray& ray, const double tMax) const {
+    if (mesh) {
+        return mesh->getTriangleIntersection(triangleIndices[reference], ray.origin, ray.direction,
+                                             Scene::EPSILON, tMax);
+    }
+    return primitives[reference]->getIntersection(ray.origin, ray.direction, ray.tMin, tMax);
+}
+
+bool BVH::primitiveOccludes(const uint32_t reference, const Ray& ray) const {
+    if (mesh) {
+        return mesh->hasTriangleIntersection(triangleIndices[reference], ray.origin, ray.direction,
+                                             ray.tMin, ray.tMax);
+    }
+    return primitives[reference]->hasIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax);
+}
+
+bool BVH::forEachPrimitiveHit(const uint32_t reference, const Ray& ray, const IntersectionCallback& callback) const {
+    if (mesh) {
+        const Intersection hit = mesh->getTriangleIntersection(triangleIndices[reference], ray.origin, ray.direction,
+                                                               Scene::EPSILON, ray.tMax);
+        return !hit || hit.lambda < ray.tMin || callback(hit);
+    }
+    return primitives[reference]->forEachIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax, callback);
+}
+
+AABB BVH::getPrimitiveBounds(const uint32_t reference) const {
+    if (mesh) {
+        return mesh->getTriangleBounds(triangleIndices[reference]);
+    }
+    return primitives[reference]->getBoundingBox();
+}
+
+uintptr_t BVH::getPrimitiveId(const uint32_t reference) const {
+    if (mesh) {
+        return triangleIndices[reference];
+    }
+    return reinterpret_cast<uintptr_t>(primitives[reference].get());
+}
+
+uint32_t BVH::flatten(const BVHNode& node) {
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    for (int i = 0; i < 3; ++i) {
+        nodes[index].min[i] = node.boundingBox.min[i];
+        nodes[index].max[i] = node.boundingBox.max[i];
+    }
+
+    // Empreinte du nœud d'origine : BVHNode alloué par make_shared, sa boîte comprise
+    stats.pointerTreeBytes += sizeof(BVHNode) + SHARED_CONTROL_BLOCK_BYTES;
+
+    if (!node.leafShapes.empty()) {
+        // Les formes d'une feuille sont rangées côte à côte dans primitives
+        nodes[index].primitivesOffset = static_cast<uint32_t>(primitives.size());
+        nodes[index].primitiveCount = static_cast<uint16_t>(node.leafShapes.size());
+        primitives.insert(primitives.end(), node.leafShapes.begin(), node.leafShapes.end());
+        stats.leafCount++;
+    } else {
+        nodes[index].primitiveCount = 0;
+        nodes[index].axis = static_cast<uint8_t>(node.axis);
+
+        // L'enfant placé juste après son parent est lu sans saut en mémoire : autant
+        // y mettre celui qu'un rayon a le plus de chances de traverser
+        const BVHNode* first = node.left.get();
+        const BVHNode* second = node.right.get();
+        if (options.nodeOrder == BVHNodeOrder::LargerChildFirst
+            && second->boundingBox.getSurfaceArea() > first->boundingBox.getSurfaceArea()) {
+            std::swap(first, second);
+            nodes[index].firstChildIsHigh = 1;
+        }
+        flatten(*first);
+        nodes[index].secondChildOffset = flatten(*second);
+    }
+
+    return index;
+}
+
+void BVH::buildLayoutNodes() {
+    wide4Nodes.clear();
+    wide8Nodes.clear();
+    quantized16Nodes.clear();
+    quantized8Nodes.clear();
+    if (nodes.empty()) {
+        return;
+    }
+
+    if (options.layout == BVHLayout::Wide4) {
+        wide4Nodes.reserve(nodes.size() / 3 + 1);
+        collapse(0, wide4Nodes);
+        stats.wideNodeCount = wide4Nodes.size();
+        stats.wideBytes = wide4Nodes.size() * sizeof(WideBVHNode<4>);
+    } else if (options.layout == BVHLayout::Wide8) {
+        wide8Nodes.reserve(nodes.size() / 7 + 1);
+        collapse(0, wide8Nodes);
+        stats.wideNodeCount = wide8Nodes.size();
+        stats.wideBytes = wide8Nodes.size() * sizeof(WideBVHNode<8>);
+    } else if (nodes[0].primitiveCount == 0) {
+        // Une racine feuille n'a pas de nœud quantifié : le parcours part de sa boîte
+        const LinearBVHNode& root = nodes[0];
+        const double box[6] = {root.min[0], root.min[1], root.min[2], root.max[0], root.max[1], root.max[2]};
+        if (options.layout == BVHLayout::Quantized16) {
+            quantized16Nodes.reserve(nodes.size() / 2);
+            quantize(0, box, quantized16Nodes);
+            stats.quantizedNodeCount = quantized16Nodes.size();
+            stats.quantizedBytes = quantized16Nodes.size() * sizeof(QuantizedBVHNode<uint16_t>);
+        } else if (options.layout == BVHLayout::Quantized8) {
+            quantized8Nodes.reserve(nodes.size() / 2);
+            quantize(0, box, quantized8Nodes);
+            stats.quantizedNodeCount = quantized8Nodes.size();
+            stats.quantizedBytes = quantized8Nodes.size() * sizeof(QuantizedBVHNode<uint8_t>);
+        }
+    }
+}
+
+double BVH::refit() {
+    if (nodes.empty()) {
+        return 1.0;
+    }
+
+    updateBoundingBoxes(primitives);
+
+    // L'aplatissement en profondeur d'abord place les enfants après leur parent :
+    // un parcours à rebours met donc à jour les enfants avant le parent
+    for (size_t i = nodes.size(); i-- > 0;) {
+        LinearBVHNode& node = nodes[i];
+        Vector3 min(INF, INF, INF);
+        Vector3 max(-INF, -INF, -INF);
+
+        if (node.primitiveCount > 0) {
+            for (uint32_t p = 0; p < node.primitiveCount; ++p) {
+                const AABB b = getPrimitiveBounds(node.primitivesOffset + p);
+                min = min.min(b.min);
+                max = max.max(b.max);
+            }
+            for (int a = 0; a < 3; ++a) {
+                node.min[a] = min[a];
+                node.max[a] = max[a];
+            }
+        } else {
+            const LinearBVHNode& first = nodes[i + 1];
+            const LinearBVHNode& second = nodes[node.secondChildOffset];
+            for (int a = 0; a < 3; ++a) {
+                node.min[a] = std::min(first.min[a], second.min[a]);
+                node.max[a] = std::max(first.max[a], second.max[a]);
+            }
+        }
+    }
+
+    // Les nœuds larges recopient les boîtes binaires : il suffit de les replier à nouveau
+    buildLayoutNodes();
+    stats.refitCount++;
+
+    return getRefitDegradation();
+}
+
+bool BVH::update(const double rebuildThreshold) {
+    if (refit() <= rebuildThreshold || mesh) {
+        return false;
+    }
+
+    rebuild();
+    return true;
+}
+
+void BVH::rebuild() {
+    // Les références dupliquées par le SBVH ne doivent compter qu'une fois : sinon
+    // chaque reconstruction découperait à nouveau les doublons de la précédente
+    std::vector<std::shared_ptr<Shape>> shapes;
+    shapes.reserve(primitives.size() - stats.duplicateCount + unboundedPrimitives.size());
+    std::unordered_set<const Shape*> seen;
+    for (const auto& shape : primitives) {
+        if (seen.insert(shape.get()).second) {
+            shapes.push_back(shape);
+        }
+    }
+    shapes.insert(shapes.end(), unboundedPrimitives.begin(), unboundedPrimitives.end());
+    *this = BVH(shapes, options);
+}
+
+void BVH::insert(const std::shared_ptr<Shape>& shape) {
+    if (mesh) {
+        throw std::runtime_error("The BVH of a mesh cannot be edited");
+    }
+
+    shape->setBoundingBox();
+    if (!shape->isBounded()) {
+        unboundedPrimitives.push_back(shape);
+        stats.unboundedCount = unboundedPrimitives.size();
+        return;
+    }
+
+    const AABB& box = shape->getBoundingBox();
+    LinearBVHNode leaf{};
+    for (int a = 0; a < 3; ++a) {
+        leaf.min[a] = box.min[a];
+        leaf.max[a] = box.max[a];
+    }
+    leaf.primitivesOffset = static_cast<uint32_t>(primitives.size());
+    leaf.primitiveCount = 1;
+    primitives.push_back(shape);
+
+    if (nodes.empty()) {
+        nodes.push_back(leaf);
+        updateEditStats();
+        buildLayoutNodes();
+        return;
+    }
+
+    const uint32_t sibling = findBestSibling(box);
+    std::vector<uint32_t> ancestors = getAncestors(sibling);
+
+    // Le nouveau parent prend la place du frère. Comme à l'aplatissement, l'enfant de
+    // plus grande aire passe en premier avec BVHNodeOrder::LargerChildFirst ; sinon la
+    // feuille vient en second, juste après le sous-arbre du frère
+    const bool leafFirst = options.nodeOrder == BVHNodeOrder::LargerChildFirst
+        && box.getSurfaceArea() > surfaceArea(nodes[sibling]);
+    LinearBVHNode parent{};
+    const Vector3 offset = box.getCenter() - Vector3(
+        (nodes[sibling].min[0] + nodes[sibling].max[0]) * 0.5,
+        (nodes[sibling].min[1] + nodes[sibling].max[1]) * 0.5,
+        (nodes[sibling].min[2] + nodes[sibling].max[2]) * 0.5);
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+        if (std::abs(offset[a]) > std::abs(offset[axis])) {
+            axis = a;
+        }
+    }
+    const bool leafIsHigh = offset[axis] > 0.0;
+    parent.axis = static_cast<uint8_t>(axis);
+    parent.firstChildIsHigh = leafIsHigh == leafFirst ? 1 : 0;
+
+    if (leafFirst) {
+        // La feuille suit le parent et le sous-arbre du frère recule de deux places
+        parent.secondChildOffset = sibling + 2;
+        for (LinearBVHNode& node : nodes) {
+            if (node.primitiveCount == 0 && node.secondChildOffset > sibling) {
+                node.secondChildOffset += 2;
+            }
+        }
+        nodes.insert(nodes.begin() + sibling, {parent, leaf});
+    } else {
+        // Le sous-arbre du frère recule d'une place derrière le parent, les nœuds
+        // suivants de deux places pour laisser la feuille entre les deux
+        const uint32_t subtreeEnd = getSubtreeEnd(sibling);
+        parent.secondChildOffset = subtreeEnd + 1;
+        for (LinearBVHNode& node : nodes) {
+            if (node.primitiveCount == 0 && node.secondChildOffset > sibling) {
+                node.secondChildOffset += node.secondChildOffset < subtreeEnd ? 1 : 2;
+            }
+        }
+        nodes.insert(nodes.begin() + subtreeEnd, leaf);
+        nodes.insert(nodes.begin() + sibling, parent);
+    }
+
+    ancestors.push_back(sibling);
+    refitNodes(ancestors);
+
+    updateEditStats();
+    if (stats.maxDepth > MAX_EDITED_DEPTH) {
+        rebuild();
+        return;
+    }
+    buildLayoutNodes();
+}
+
+bool BVH::remove(const std::shared_ptr<Shape>& shape) {
+    if (mesh) {
+        throw std::runtime_error("The BVH of a mesh cannot be edited");
+    }
+
+    const auto unbounded = std::find(unboundedPrimitives.begin(), unboundedPrimitives.end(), shape);
+    if (unbounded != unboundedPrimitives.end()) {
+        unboundedPrimitives.erase(unbounded);
+        stats.unboundedCount = unboundedPrimitives.size();
+        return true;
+    }
+
+    // Une forme découpée par le SBVH est référencée par plusieurs feuilles
+    size_t references = 0;
+    for (auto it = std::find(primitives.begin(), primitives.end(), shape); it != primitives.end();
+         it = std::find(primitives.begin(), primitives.end(), shape)) {
+        removeReference(static_cast<uint32_t>(it - primitives.begin()));
+        references++;
+    }
+    if (references == 0) {
+        return false;
+    }
+
+    stats.duplicateCount -= std::min(stats.duplicateCount, references - 1);
+    updateEditStats();
+    buildLayoutNodes();
+    return true;
+}
+
+uint32_t BVH::findBestSibling(const AABB& box) const {
+    // File ordonnée par coût hérité : agrandissement des ancêtres d'un candidat si la
+    // boîte y est ajoutée. Le coût d'un candidat et de tout son sous-arbre est au
+    // moins ce coût hérité plus l'aire de la boîte, d'où l'arrêt de la recherche
+    using Candidate = std::pair<double, uint32_t>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> candidates;
+    candidates.emplace(0.0, 0);
+
+    const double boxArea = box.getSurfaceArea();
+    uint32_t best = 0;
+    double bestCost = INF;
+    while (!candidates.empty()) {
+        const auto [inheritedCost, index] = candidates.top();
+        candidates.pop();
+        if (inheritedCost + boxArea >= bestCost) {
+            break;
+        }
+
+        const LinearBVHNode& node = nodes[index];
+        const double grownArea = unionArea(node, box);
+        const double cost = inheritedCost + grownArea;
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = index;
+        }
+
+        const double childInheritedCost = cost - surfaceArea(node);
+        if (node.primitiveCount == 0 && childInheritedCost + boxArea < bestCost) {
+            candidates.emplace(childInheritedCost, index + 1);
+            candidates.emplace(childInheritedCost, node.secondChildOffset);
+        }
+    }
+    return best;
+}
+
+std::vector<uint32_t> BVH::getAncestors(const uint32_t index) const {
+    // Le sous-arbre d'un nœud occupe une plage contiguë qui commence par lui : on
+    // descend dans le second enfant dès que index n'est pas avant lui
+    std::vector<uint32_t> ancestors;
+    for (uint32_t current = 0; current != index;) {
+        ancestors.push_back(current);
+        const uint32_t second = nodes[current].secondChildOffset;
+        current = index >= second ? second : current + 1;
+    }
+    return ancestors;
+}
+
+uint32_t BVH::getSubtreeEnd(uint32_t index) const {
+    // Le second enfant est rangé après tout le sous-arbre du premier : le dernier nœud
+    // du sous-arbre est la feuille atteinte en suivant les seconds enfants
+    while (nodes[index].primitiveCount == 0) {
+        index = nodes[index].secondChildOffset;
+    }
+    return index + 1;
+}
+
+void BVH::refitNodes(const std::vector<uint32_t>& path) {
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        LinearBVHNode& node = nodes[*it];
+        if (node.primitiveCount > 0) {
+            AABB box;
+            for (uint32_t p = 0; p < node.primitiveCount; ++p) {
+                box.grow(getPrimitiveBounds(node.primitivesOffset + p));
+            }
+            for (int a = 0; a < 3; ++a) {
+                node.min[a] = box.min[a];
+                node.max[a] = box.max[a];
+            }
+        } else {
+            const LinearBVHNode& first = nodes[*it + 1];
+            const LinearBVHNode& second = nodes[node.secondChildOffset];
+            for (int a = 0; a < 3; ++a) {
+                node.min[a] = std::min(first.min[a], second.min[a]);
+                node.max[a] = std::max(first.max[a], second.max[a]);
+            }
+        }
+    }
+}
+
+void BVH::removeReference(const uint32_t reference) {
+    const auto leafIt = std::find_if(nodes.begin(), nodes.end(), [reference](const LinearBVHNode& node) {
+        return node.primitiveCount > 0 && node.primitivesOffset <= reference
+            && reference < node.primitivesOffset + node.primitiveCount;
+    });
+    const uint32_t leaf = static_cast<uint32_t>(leafIt - nodes.begin());
+    std::vector<uint32_t> ancestors = getAncestors(leaf);
+
+    primitives.erase(primitives.begin() + reference);
+    for (LinearBVHNode& node : nodes) {
+        if (node.primitiveCount > 0 && node.primitivesOffset > reference) {
+            node.primitivesOffset--;
+        }
+    }
+
+    if (nodes[leaf].primitiveCount > 1) {
+        nodes[leaf].primitiveCount--;
+        ancestors.push_back(leaf);
+    } else if (ancestors.empty()) {
+        nodes.clear();
+    } else {
+        // Le parent et la feuille disparaissent : le frère prend la place du parent
+        const uint32_t parent = ancestors.back();
+        ancestors.pop_back();
+        for (LinearBVHNode& node : nodes) {
+            if (node.primitiveCount == 0) {
+                const uint32_t child = node.secondChildOffset;
+                node.secondChildOffset = child - (child > parent ? 1 : 0) - (child > leaf ? 1 : 0);
+            }
+        }
+        nodes.erase(nodes.begin() + leaf);
+        nodes.erase(nodes.begin() + parent);
+    }
+
+    refitNodes(ancestors);
+}
+
+void BVH::updateEditStats() {
+    stats.nodeCount = nodes.size();
+    stats.leafCount = static_cast<size_t>(std::count_if(nodes.begin(), nodes.end(),
+        [](const LinearBVHNode& node) { return node.primitiveCount > 0; }));
+    stats.primitiveCount = primitives.size();
+    stats.bytes = nodes.size() * sizeof(LinearBVHNode);
+    stats.pointerTreeBytes = nodes.size() * (sizeof(BVHNode) + SHARED_CONTROL_BLOCK_BYTES);
+    stats.maxDepth = computeMaxDepth();
+
+    // La référence reste le coût de la dernière construction : les modifications
+    // successives s'accumulent dans la dégradation jusqu'à la reconstruction.
+    // Un arbre parti de rien prend pour référence sa première feuille
+    if (stats.builtSAHCost <= 0.0) {
+        stats.builtSAHCost = getSAHCost();
+    }
+}
+
+int BVH::computeMaxDepth() const {
+    // Les deux enfants d'un nœud sont rangés après lui : un seul passage dans l'ordre
+    // du tableau propage les profondeurs
+    std::vector<int> depths(nodes.size(), 0);
+    int maxDepth = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].primitiveCount > 0) {
+            maxDepth = std::max(maxDepth, depths[i]);
+        } else {
+            depths[i + 1] = depths[i] + 1;
+            depths[nodes[i].secondChildOffset] = depths[i] + 1;
+        }
+    }
+    return maxDepth;
+}
+
+double BVH::getRefitDegradation() const {
+    return stats.builtSAHCost > 0.0 ? getSAHCost() / stats.builtSAHCost : 1.0;
+}
+
+template <int N>
+uint32_t BVH::collapse(const uint32_t binaryIndex, std::vector<WideBVHNode<N>>& wideNodes) const {
+    // On ouvre l'enfant interne de plus grande aire jusqu'à obtenir N enfants :
+    // c'est lui qui a la plus forte probabilité d'être visité
+    uint32_t slots[N];
+    int slotCount = 0;
+    if (nodes[binaryIndex].primitiveCount > 0) {
+        slots[slotCount++] = binaryIndex;
+    } else {
+        slots[slotCount++] = binaryIndex + 1;
+        slots[slotCount++] = nodes[binaryIndex].secondChildOffset;
+    }
+
+    while (slotCount < N) {
+        int best = -1;
+        double bestArea = -1.0;
+        for (int i = 0; i < slotCount; ++i) {
+            const LinearBVHNode& node = nodes[slots[i]];
+            if (node.primitiveCount == 0 && surfaceArea(node) > bestArea) {
+                best = i;
+                bestArea = surfaceArea(node);
+            }
+        }
+        if (best < 0) break;
+
+        const uint32_t opened = slots[best];
+        slots[best] = opened + 1;
+        slots[slotCount++] = nodes[opened].secondChildOffset;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(wideNodes.size());
+    wideNodes.emplace_back();
+
+    for (int i = 0; i < slotCount; ++i) {
+        const LinearBVHNode& node = nodes[slots[i]];
+        const bool isLeaf = node.primitiveCount > 0;
+        const uint32_t child = isLeaf ? node.primitivesOffset : collapse(slots[i], wideNodes);
+
+        // La récursion a pu réallouer wideNodes : le nœud est relu par son indice
+        WideBVHNode<N>& wide = wideNodes[index];
+        for (int a = 0; a < 3; ++a) {
+            wide.bounds[a][i] = node.min[a];
+            wide.bounds[3 + a][i] = node.max[a];
+        }
+        wide.child[i] = child;
+        wide.primitiveCount[i] = isLeaf ? node.primitiveCount : 0;
+        wide.validMask |= static_cast<uint8_t>(1 << i);
+    }
+
+    return index;
+}
+
+template <typename T>
+uint32_t BVH::quantize(const uint32_t binaryIndex, const double box[6],
+                       std::vector<QuantizedBVHNode<T>>& quantizedNodes) const {
+    const uint32_t index = static_cast<uint32_t>(quantizedNodes.size());
+    quantizedNodes.emplace_back();
+
+    const uint32_t children[2] = {binaryIndex + 1, nodes[binaryIndex].secondChildOffset};
+    for (int c = 0; c < 2; ++c) {
+        const LinearBVHNode& node = nodes[children[c]];
+
+        // Codage conservatif, puis boîte telle que le parcours la décodera : c'est
+        // elle, et non la boîte exacte, qui sert de repère aux petits-enfants
+        T quantized[6];
+        double childBox[6];
+        for (int a = 0; a < 3; ++a) {
+            const double lo = box[a];
+            const double hi = box[3 + a];
+            const double step = quantizationStep<T>(lo, hi);
+            quantized[a] = quantizeMin<T>(node.min[a], lo, step);
+            quantized[3 + a] = quantizeMax<T>(node.max[a], lo, hi, step);
+            childBox[a] = dequantizeMin<T>(quantized[a], lo, step);
+            childBox[3 + a] = dequantizeMax<T>(quantized[3 + a], lo, hi, step);
+        }
+
+        const bool isLeaf = node.primitiveCount > 0;
+        const uint32_t child = isLeaf ? node.primitivesOffset : quantize(children[c], childBox, quantizedNodes);
+
+        // La récursion a pu réallouer quantizedNodes : le nœud est relu par son indice
+        QuantizedBVHNode<T>& quantizedNode = quantizedNodes[index];
+        for (int i = 0; i < 6; ++i) {
+            quantizedNode.bounds[i][c] = quantized[i];
+        }
+        quantizedNode.child[c] = child;
+        quantizedNode.primitiveCount[c] = isLeaf ? node.primitiveCount : 0;
+    }
+
+    return index;
+}
+
+Intersection BVH::getIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    return getIntersection(Ray(P, v, tMin, tMax));
+}
+
+Intersection BVH::getIntersection(const Ray& ray) const {
+    // Les primitives non bornées d'abord : leur intersection resserre tMax pour l'arbre
+    double tMax = ray.tMax;
+    Intersection closest = intersectUnbounded(ray, tMax);
+
+    if (nodes.empty()) {
+        return closest;
+    }
+
+    if (options.layout == BVHLayout::Wide4) {
+        closestHitWide(wide4Nodes, ray, tMax, closest);
+        return closest;
+    }
+    if (options.layout == BVHLayout::Wide8) {
+        closestHitWide(wide8Nodes, ray, tMax, closest);
+        return closest;
+    }
+    if (options.layout == BVHLayout::Quantized16) {
+        closestHitQuantized(quantized16Nodes, ray, tMax, closest);
+        return closest;
+    }
+    if (options.layout == BVHLayout::Quantized8) {
+        closestHitQuantized(quantized8Nodes, ray, tMax, closest);
+        return closest;
+    }
+
+    closestHitBinary(0, ray, tMax, closest);
+    return closest;
+}
+
+void BVH::closestHitBinary(const uint32_t root, const Ray& ray, double& tMax, Intersection& closest) const {
+    double rootEntry = 0.0;
+    if (!intersectBox(nodes[root], ray, tMax, rootEntry)) {
+        return;
+    }
+
+    StackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = {root, rootEntry};
+
+    while (stackSize > 0) {
+        const StackEntry entry = stack[--stackSize];
+
+        // Le sous-arbre commence au-delà de l'intersection la plus proche : inutile d'y descendre
+        if (entry.tEntry > tMax) continue;
+
+        const LinearBVHNode& node = nodes[entry.node];
+
+        if (node.primitiveCount > 0) {
+            for (uint32_t i = 0; i < node.primitiveCount; ++i) {
+                const Intersection inter = intersectPrimitive(node.primitivesOffset + i, ray, tMax);
+                if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+                    closest = inter;
+                    tMax = inter.lambda;
+                }
+            }
+            continue;
+        }
+
+        // Test des deux enfants : le plus proche est empilé en dernier pour être visité en premier
+        const uint32_t firstChild = entry.node + 1;
+        const uint32_t secondChild = node.secondChildOffset;
+        double tFirst = 0.0, tSecond = 0.0;
+        const bool hitFirst = intersectBox(nodes[firstChild], ray, tMax, tFirst);
+        const bool hitSecond = intersectBox(nodes[secondChild], ray, tMax, tSecond);
+
+        if (hitFirst && hitSecond) {
+            const bool firstIsNear = tFirst <= tSecond;
+            const uint32_t far = firstIsNear ? secondChild : firstChild;
+            if (firstIsNear) {
+                stack[stackSize++] = {secondChild, tSecond};
+                stack[stackSize++] = {firstChild, tFirst};
+            } else {
+                stack[stackSize++] = {firstChild, tFirst};
+                stack[stackSize++] = {secondChild, tSecond};
+            }
+
+            // Les enfants du nœud lointain seront testés au retour sur la pile :
+            // leur chargement se fait pendant la descente dans le nœud proche
+            if (nodes[far].primitiveCount == 0) {
+                prefetch(&nodes[far + 1], sizeof(LinearBVHNode));
+                prefetch(&nodes[nodes[far].secondChildOffset], sizeof(LinearBVHNode));
+            }
+        } else if (hitFirst) {
+            stack[stackSize++] = {firstChild, tFirst};
+        } else if (hitSecond) {
+            stack[stackSize++] = {secondChild, tSecond};
+        }
+    }
+}
+
+void BVH::getIntersections(const Ray* rays, const int count, Intersection* hits) const {
+    PacketRays packet;
+    const bool coherent = count > 0 && count <= MAX_PACKET_SIZE && packet.load(rays, count);
+
+    // Seul l'arbre binaire est parcouru en paquet ; un paquet incohérent ou trop
+    // grand est tracé rayon par rayon
+    if (!coherent || nodes.empty() || options.layout != BVHLayout::Binary) {
+        for (int i = 0; i < count; ++i) {
+            hits[i] = getIntersection(rays[i]);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        hits[i] = intersectUnbounded(rays[i], packet.tMax[i]);
+    }
+
+    double packetTMin = INF;
+    double packetTMax = -INF;
+    for (int i = 0; i < count; ++i) {
+        packetTMin = std::min(packetTMin, packet.tMin[i]);
+        packetTMax = std::max(packetTMax, packet.tMax[i]);
+    }
+
+    // En dessous de ce nombre de rayons actifs, le paquet a divergé : chaque rayon
+    // finit le sous-arbre seul, avec l'ordre avant-arrière et l'élagage par distance
+    const int divergedCount = std::max(1, count / 4);
+
+    PacketStackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = {0, (1u << count) - 1};
+
+    while (stackSize > 0) {
+        const PacketStackEntry entry = stack[--stackSize];
+        const LinearBVHNode& node = nodes[entry.node];
+
+        if (packet.hasFrustum && frustumMisses(node, packet, packetTMin, packetTMax)) continue;
+
+        const uint32_t active = intersectPacket(node, packet, entry.active);
+        if (!active) continue;
+
+        if (static_cast<int>(std::bitset<MAX_PACKET_SIZE>(active).count()) <= divergedCount) {
+            for (int i = 0; i < count; ++i) {
+                if (active & (1u << i)) closestHitBinary(entry.node, rays[i], packet.tMax[i], hits[i]);
+            }
+        } else if (node.primitiveCount > 0) {
+            for (int i = 0; i < count; ++i) {
+                if (!(active & (1u << i))) continue;
+                for (uint32_t p = 0; p < node.primitiveCount; ++p) {
+                    const Intersection inter = intersectPrimitive(node.primitivesOffset + p, rays[i], packet.tMax[i]);
+                    if (inter.lambda >= rays[i].tMin && inter.lambda < packet.tMax[i]) {
+                        hits[i] = inter;
+                        packet.tMax[i] = inter.lambda;
+                    }
+                }
+            }
+        } else {
+            // Directions de même signe : l'axe de découpe donne l'enfant proche pour tout le paquet
+            if ((packet.sign[node.axis] != 0) != (node.firstChildIsHigh != 0)) {
+                stack[stackSize++] = {entry.node + 1, active};
+                stack[stackSize++] = {node.secondChildOffset, active};
+            } else {
+                stack[stackSize++] = {node.secondChildOffset, active};
+                stack[stackSize++] = {entry.node + 1, active};
+            }
+            continue;
+        }
+
+        packetTMax = -INF;
+        for (int i = 0; i < count; ++i) {
+            packetTMax = std::max(packetTMax, packet.tMax[i]);
+        }
+    }
+}
+
+bool BVH::occluded(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    return occluded(Ray(P, v, tMin, tMax));
+}
+
+bool BVH::occluded(const Ray& ray) const {
+    if (unboundedOccluded(ray)) {
+        return true;
+    }
+
+    if (nodes.empty()) {
+        return false;
+    }
+
+    if (options.layout == BVHLayout::Wide4) {
+        return occludedWide(wide4Nodes, ray);
+    }
+    if (options.layout == BVHLayout::Wide8) {
+        return occludedWide(wide8Nodes, ray);
+    }
+    if (options.layout == BVHLayout::Quantized16) {
+        return occludedQuantized(quantized16Nodes, ray);
+    }
+    if (options.layout == BVHLayout::Quantized8) {
+        return occludedQuantized(quantized8Nodes, ray);
+    }
+
+    uint32_t stack[STACK_SIZE];
+    int stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        double tEntry;
+
+        if (intersectBox(node, ray, ray.tMax, tEntry)) {
+            if (node.primitiveCount > 0) {
+                for (uint32_t i = 0; i < node.primitiveCount; ++i) {
+                    if (primitiveOccludes(node.primitivesOffset + i, ray)) {
+                        return true;
+                    }
+                }
+            } else {
+                // N'importe quel ordre convient ; le signe de la direction sur l'axe
+                // de découpe donne gratuitement l'enfant le plus probable en premier
+                if ((ray.sign[node.axis] != 0) != (node.firstChildIsHigh != 0)) {
+                    stack[stackSize++] = current + 1;
+                    current = node.secondChildOffset;
+                } else {
+                    stack[stackSize++] = node.secondChildOffset;
+                    current = current + 1;
+                }
+                prefetch(&nodes[stack[stackSize - 1]], sizeof(LinearBVHNode));
+                continue;
+            }
+        }
+
+        if (stackSize == 0) break;
+        current = stack[--stackSize];
+    }
+
+    return false;
+}
+
+bool BVH::forEachHit(const Vector3& P, const Vector3& v, const double tMin, const double tMax,
+                     const IntersectionCallback& callback) const {
+    return forEachHit(Ray(P, v, tMin, tMax), callback);
+}
+
+bool BVH::forEachHit(const Ray& ray, const IntersectionCallback& callback) const {
+    if (!forEachUnboundedHit(ray, callback)) {
+        return false;
+    }
+
+    if (nodes.empty()) {
+        return true;
+    }
+
+    if (options.layout == BVHLayout::Wide4) {
+        return forEachHitWide(wide4Nodes, ray, callback);
+    }
+    if (options.layout == BVHLayout::Wide8) {
+        return forEachHitWide(wide8Nodes, ray, callback);
+    }
+    if (options.layout == BVHLayout::Quantized16) {
+        return forEachHitQuantized(quantized16Nodes, ray, callback);
+    }
+    if (options.layout == BVHLayout::Quantized8) {
+        return forEachHitQuantized(quantized8Nodes, ray, callback);
+    }
+
+    VisitedPrimitives visited(stats.duplicateCount > 0);
+
+    uint32_t stack[STACK_SIZE];
+    int stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        double tEntry;
+
+        if (intersectBox(node, ray, ray.tMax, tEntry)) {
+            if (node.primitiveCount > 0) {
+                for (uint32_t i = 0; i < node.primitiveCount; ++i) {
+                    const uint32_t reference = node.primitivesOffset + i;
+                    if (!visited.firstVisit(getPrimitiveId(reference))) continue;
+                    if (!forEachPrimitiveHit(reference, ray, callback)) {
+                        return false;
+                    }
+                }
+            } else {
+                stack[stackSize++] = node.secondChildOffset;
+                current = current + 1;
+                prefetch(&nodes[node.secondChildOffset], sizeof(LinearBVHNode));
+                continue;
+            }
+        }
+
+        if (stackSize == 0) break;
+        current = stack[--stackSize];
+    }
+
+    return true;
+}
+
+template <int N>
+void BVH::closestHitWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray,
+                         double& tMax, Intersection& closest) const {
+    double rootEntry = 0.0;
+    if (!intersectBox(nodes[0], ray, tMax, rootEntry)) {
+        return;
+    }
+
+    const WideRay wideRay(ray);
+
+    // Chaque niveau empile au plus N - 1 entrées de plus qu'il n'en dépile
+    WideStackEntry stack[STACK_SIZE * (N - 1)];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0, rootEntry};
+
+    while (stackSize > 0) {
+        const WideStackEntry entry = stack[--stackSize];
+
+        if (entry.tEntry > tMax) continue;
+
+        if (entry.primitiveCount > 0) {
+            for (uint32_t i = 0; i < entry.primitiveCount; ++i) {
+                const Intersection inter = intersectPrimitive(entry.index + i, ray, tMax);
+                if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+                    closest = inter;
+                    tMax = inter.lambda;
+                }
+            }
+            continue;
+        }
+
+        const WideBVHNode<N>& node = wideNodes[entry.index];
+        double tNear[N];
+        const int mask = intersectChildren(node, wideRay, tMax, tNear);
+
+        // Insertion triée des enfants touchés, du plus lointain au plus proche :
+        // le plus proche se retrouve au sommet de la pile
+        const int first = stackSize;
+        for (int i = 0; i < N; ++i) {
+            if (!(mask & (1 << i))) continue;
+            const WideStackEntry child = {node.child[i], node.primitiveCount[i], tNear[i]};
+            int j = stackSize++;
+            while (j > first && stack[j - 1].tEntry < child.tEntry) {
+                stack[j] = stack[j - 1];
+                --j;
+            }
+            stack[j] = child;
+        }
+
+        // Le plus proche est visité tout de suite ; les autres nœuds internes
+        // empilés sont chargés en attendant leur tour
+        for (int i = first; i < stackSize - 1; ++i) {
+            if (stack[i].primitiveCount == 0) {
+                prefetch(&wideNodes[stack[i].index], sizeof(WideBVHNode<N>));
+            }
+        }
+    }
+}
+
+template <int N>
+bool BVH::occludedWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray) const {
+    double rootEntry = 0.0;
+    if (!intersectBox(nodes[0], ray, ray.tMax, rootEntry)) {
+        return false;
+    }
+
+    const WideRay wideRay(ray);
+
+    uint32_t stack[STACK_SIZE * (N - 1)];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const WideBVHNode<N>& node = wideNodes[stack[--stackSize]];
+        double tNear[N];
+        const int mask = intersectChildren(node, wideRay, ray.tMax, tNear);
+
+        for (int i = 0; i < N; ++i) {
+            if (!(mask & (1 << i))) continue;
+            if (node.primitiveCount[i] == 0) {
+                stack[stackSize++] = node.child[i];
+                continue;
+            }
+            for (uint32_t p = 0; p < node.primitiveCount[i]; ++p) {
+                if (primitiveOccludes(node.child[i] + p, ray)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+template <int N>
+bool BVH::forEachHitWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray,
+                         const IntersectionCallback& callback) const {
+    double rootEntry = 0.0;
+    if (!intersectBox(nodes[0], ray, ray.tMax, rootEntry)) {
+        return true;
+    }
+
+    const WideRay wideRay(ray);
+    VisitedPrimitives visited(stats.duplicateCount > 0);
+
+    uint32_t stack[STACK_SIZE * (N - 1)];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const WideBVHNode<N>& node = wideNodes[stack[--stackSize]];
+        double tNear[N];
+        const int mask = intersectChildren(node, wideRay, ray.tMax, tNear);
+
+        for (int i = 0; i < N; ++i) {
+            if (!(mask & (1 << i))) continue;
+            if (node.primitiveCount[i] == 0) {
+                stack[stackSize++] = node.child[i];
+                continue;
+            }
+            for (uint32_t p = 0; p < node.primitiveCount[i]; ++p) {
+                const uint32_t reference = node.child[i] + p;
+                if (!visited.firstVisit(getPrimitiveId(reference))) continue;
+                if (!forEachPrimitiveHit(reference, ray, callback)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+void BVH::closestHitQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray,
+                              double& tMax, Intersection& closest) const {
+    double tRoot = 0.0;
+    if (!intersectBox(nodes[0], ray, tMax, tRoot)) {
+        return;
+    }
+
+    QuantizedStackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = rootEntry(nodes[0], tRoot);
+
+    while (stackSize > 0) {
+        // L'entrée n'est lue qu'avant d'empiler les enfants, qui peuvent l'écraser
+        const QuantizedStackEntry& entry = stack[--stackSize];
+
+        if (entry.tEntry > tMax) continue;
+
+        if (entry.primitiveCount > 0) {
+            for (uint32_t i = 0; i < entry.primitiveCount; ++i) {
+                const Intersection inter = intersectPrimitive(entry.index + i, ray, tMax);
+                if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+                    closest = inter;
+                    tMax = inter.lambda;
+                }
+            }
+            continue;
+        }
+
+        const QuantizedBVHNode<T>& node = quantizedNodes[entry.index];
+        double childBox[2][6];
+        decodeChildren(node, entry.box, childBox);
+
+        double tChild[2] = {0.0, 0.0};
+        const bool hit[2] = {
+            intersectBounds(childBox[0], ray, tMax, tChild[0]),
+            intersectBounds(childBox[1], ray, tMax, tChild[1])
+        };
+
+        // Le plus proche est empilé en dernier pour être visité en premier ;
+        // le lointain est chargé en cache pendant ce temps
+        const int near = hit[0] && hit[1] ? (tChild[0] <= tChild[1] ? 0 : 1) : (hit[0] ? 0 : 1);
+        const int far = 1 - near;
+        if (hit[far]) {
+            stack[stackSize++] = childEntry(node.child[far], node.primitiveCount[far], tChild[far], childBox[far]);
+            if (node.primitiveCount[far] == 0) {
+                prefetch(&quantizedNodes[node.child[far]], sizeof(QuantizedBVHNode<T>));
+            }
+        }
+        if (hit[near]) {
+            stack[stackSize++] = childEntry(node.child[near], node.primitiveCount[near], tChild[near], childBox[near]);
+        }
+    }
+}
+
+template <typename T>
+bool BVH::occludedQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray) const {
+    double tRoot = 0.0;
+    if (!intersectBox(nodes[0], ray, ray.tMax, tRoot)) {
+        return false;
+    }
+
+    QuantizedStackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = rootEntry(nodes[0], tRoot);
+
+    while (stackSize > 0) {
+        const QuantizedStackEntry& entry = stack[--stackSize];
+
+        if (entry.primitiveCount > 0) {
+            for (uint32_t i = 0; i < entry.primitiveCount; ++i) {
+                if (primitiveOccludes(entry.index + i, ray)) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        const QuantizedBVHNode<T>& node = quantizedNodes[entry.index];
+        double childBox[2][6];
+        decodeChildren(node, entry.box, childBox);
+
+        double tChild[2] = {0.0, 0.0};
+        const bool hit[2] = {
+            intersectBounds(childBox[0], ray, ray.tMax, tChild[0]),
+            intersectBounds(childBox[1], ray, ray.tMax, tChild[1])
+        };
+
+        // N'importe quel ordre convient : l'enfant le plus proche d'abord, les
+        // feuilles testées tout de suite et le nœud interne le plus proche au sommet
+        const int near = tChild[1] < tChild[0] ? 1 : 0;
+        for (const int c : {near, 1 - near}) {
+            if (!hit[c] || node.primitiveCount[c] == 0) continue;
+            for (uint32_t i = 0; i < node.primitiveCount[c]; ++i) {
+                if (primitiveOccludes(node.child[c] + i, ray)) {
+                    return true;
+                }
+            }
+        }
+        for (const int c : {1 - near, near}) {
+            if (hit[c] && node.primitiveCount[c] == 0) {
+                stack[stackSize++] = childEntry(node.child[c], 0, tChild[c], childBox[c]);
+            }
+        }
+    }
+
+    return false;
+}
+
+template <typename T>
+bool BVH::forEachHitQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray,
+                              const IntersectionCallback& callback) const {
+    double tRoot = 0.0;
+    if (!intersectBox(nodes[0], ray, ray.tMax, tRoot)) {
+        return true;
+    }
+
+    VisitedPrimitives visited(stats.duplicateCount > 0);
+
+    QuantizedStackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = rootEntry(nodes[0], tRoot);
+
+    auto visitLeaf = [&](const uint32_t offset, const uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!visited.firstVisit(getPrimitiveId(offset + i))) continue;
+            if (!forEachPrimitiveHit(offset + i, ray, callback)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    while (stackSize > 0) {
+        const QuantizedStackEntry& entry = stack[--stackSize];
+
+        if (entry.primitiveCount > 0) {
+            if (!visitLeaf(entry.index, entry.primitiveCount)) return false;
+            continue;
+        }
+
+        const QuantizedBVHNode<T>& node = quantizedNodes[entry.index];
+        double childBox[2][6];
+        decodeChildren(node, entry.box, childBox);
+
+        for (int c = 0; c < 2; ++c) {
+            double tChild;
+            if (!intersectBounds(childBox[c], ray, ray.tMax, tChild)) continue;
+            if (node.primitiveCount[c] == 0) {
+                stack[stackSize++] = childEntry(node.child[c], 0, tChild, childBox[c]);
+            } else if (!visitLeaf(node.child[c], node.primitiveCount[c])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+double BVH::getSAHCost() const {
+    if (nodes.empty()) {
+        return 0.0;
+    }
+
+    // Coût espéré : chaque nœud est atteint avec une probabilité égale au
+    // rapport de son aire sur celle de la racine
+    const double rootArea = surfaceArea(nodes[0]);
+    double cost = 0.0;
+    for (const LinearBVHNode& node : nodes) {
+        const double p = surfaceArea(node) / rootArea;
+        cost += node.primitiveCount > 0
+            ? p * options.leafCost * node.primitiveCount
+            : p * options.traversalCost;
+    }
+    return cost;
+}
+
+AABB BVH::getBounds() const {
+    if (nodes.empty()) {
+        return AABB(Vector3(0, 0, 0), Vector3(0, 0, 0));
+    }
+    const LinearBVHNode& root = nodes[0];
+    return AABB(Vector3(root.min[0], root.min[1], root.min[2]),
+                Vector3(root.max[0], root.max[1], root.max[2]));
+}
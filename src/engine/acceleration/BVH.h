@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <memory>
+#include "Accelerator.h"
+#include "BVHNode.h"
+#include "AABB.h"
+#include "../Vector.h"
+#include "../Ray.h"
+#include "../Intersection.h"
+#include "../shapes/Shape.h"
+#include "../scenes/Scene.h"
+
+class Mesh;
+
+/**
+ * Nœud compact du BVH linéarisé : 64 octets, soit une ligne de cache.
+ * Un nœud interne est immédiatement suivi de son premier enfant ; le second
+ * est désigné par secondChildOffset. Selon BVHBuildOptions::nodeOrder, le premier
+ * enfant peut être le côté haut de la découpe (firstChildIsHigh). Une feuille référence la plage
+ * [primitivesOffset, primitivesOffset + primitiveCount[ du tableau de primitives.
+ */
+struct alignas(64) LinearBVHNode {
+    double min[3];
+    double max[3];
+    union {
+        uint32_t primitivesOffset;  ///< Feuille
+        uint32_t secondChildOffset; ///< Nœud interne
+    };
+    uint16_t primitiveCount;        ///< 0 pour un nœud interne
+    uint8_t axis;                   ///< Axe de découpe (nœud interne)
+    uint8_t firstChildIsHigh;       ///< Nœud interne : 1 si le premier enfant est le côté haut de la découpe
+};
+static_assert(sizeof(LinearBVHNode) == 64, "LinearBVHNode doit tenir dans une ligne de cache");
+
+/**
+ * Nœud d'un BVH large à N enfants, obtenu en repliant l'arbre binaire.
+ * Les boîtes des enfants sont rangées par plan (SoA) : bounds[0..2] sont les
+ * minima en x, y, z et bounds[3..5] les maxima, chaque ligne contenant les N
+ * enfants côte à côte pour être chargée dans des registres SIMD.
+ * Un enfant de primitiveCount nul est un nœud interne d'indice child, sinon
+ * c'est une feuille couvrant [child, child + primitiveCount[ des primitives.
+ */
+template <int N>
+struct alignas(64) WideBVHNode {
+    static_assert(N == 4 || N == 8, "WideBVHNode gère 4 ou 8 enfants");
+
+    double bounds[6][N];
+    uint32_t child[N];
+    uint16_t primitiveCount[N];
+    uint8_t validMask; ///< Bit i à 1 si l'enfant i existe
+};
+
+/**
+ * Nœud d'un BVH quantifié : les boîtes des deux enfants sont codées sur T (8 ou
+ * 16 bits) par plan, en fractions de la boîte du nœud telle que décodée depuis son
+ * parent ; seule la racine garde sa boîte en double précision. Les minima sont
+ * arrondis vers le bas et les maxima vers le haut : la boîte décodée contient
+ * toujours la vraie boîte de l'enfant.
+ * Un enfant de primitiveCount nul est un nœud interne d'indice child, sinon
+ * c'est une feuille couvrant [child, child + primitiveCount[ des primitives.
+ */
+template <typename T>
+struct QuantizedBVHNode {
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>,
+                  "QuantizedBVHNode gère des boîtes sur 8 ou 16 bits");
+
+    static constexpr int MAX_VALUE = std::numeric_limits<T>::max();
+
+    T bounds[6][2]; ///< Minima x, y, z puis maxima, pour chacun des deux enfants
+    uint32_t child[2];
+    uint16_t primitiveCount[2];
+};
+
+/**
+ * Statistiques mémoire et de construction du BVH ; bytes compte les nœuds linéarisés
+ * et buildMilliseconds inclut l'aplatissement.
+ */
+struct BVHStats : AcceleratorStats {
+    size_t duplicateCount = 0; ///< Références supplémentaires créées par les découpes spatiales (SBVH)
+    size_t wideNodeCount = 0;  ///< Nœuds de l'arbre large, 0 pour la disposition binaire
+    size_t wideBytes = 0;     ///< Mémoire des nœuds de l'arbre large
+    size_t quantizedNodeCount = 0; ///< Nœuds de l'arbre quantifié, 0 pour les autres dispositions
+    size_t quantizedBytes = 0;     ///< Mémoire des nœuds de l'arbre quantifié
+    size_t pointerTreeBytes = 0; ///< Estimation de l'arbre de BVHNode équivalent (shared_ptr)
+    double builtSAHCost = 0.0;  ///< Coût SAH à la construction, référence de la qualité après refit
+    size_t refitCount = 0;      ///< Refits depuis la dernière construction
+    int maxDepth = 0;           ///< Profondeur de la feuille la plus profonde, la racine étant à 0
+
+    double pointerTreeBytesPerNode() const { return nodeCount ? static_cast<double>(pointerTreeBytes) / nodeCount : 0.0; }
+};
+
+/**
+ * BVH stocké dans un tableau contigu de nœuds compacts, parcouru sans récursion.
+ * L'arbre est construit par BVHNode puis aplati en profondeur d'abord.
+ * Les primitives non bornées (plans) restent dans une petite liste à part,
+ * testée directement à chaque requête.
+ * Avec une disposition large (BVHLayout::Wide4/Wide8), l'arbre binaire est
+ * replié en nœuds à 4 ou 8 enfants et toutes les requêtes parcourent ce dernier.
+ * Avec une disposition quantifiée (BVHLayout::Quantized16/Quantized8), les
+ * requêtes parcourent une copie compressée de l'arbre binaire, dont les boîtes
+ * sont décodées à la volée. L'arbre binaire reste la référence du refit et du
+ * cache disque.
+ * Le BVH d'un maillage indexé (Mesh) référence ses triangles par indice plutôt que
+ * par des formes, et les teste à travers le maillage ; comme le maillage, il est figé.
+ */
+class BVH : public Accelerator {
+public:
+    // Dégradation du coût SAH au-delà de laquelle update() reconstruit l'arbre
+    static constexpr double DEFAULT_REBUILD_THRESHOLD = 1.5;
+
+    // Plus grand paquet de rayons accepté par getIntersections
+    static constexpr int MAX_PACKET_SIZE = 16;
+
+    explicit BVH(const std::vector<std::shared_ptr<Shape>>& shapes, const BVHBuildOptions& options = {});
+
+    // Reprend un arbre déjà construit, par exemple lu depuis un cache disque : nodes et
+    // primitives sont ceux renvoyés par getNodes() et getPrimitives(), sans primitive non bornée
+    BVH(std::vector<LinearBVHNode> nodes, std::vector<std::shared_ptr<Shape>> primitives,
+        const BVHBuildOptions& options);
+
+    // Reprend un arbre déjà construit dont les primitives sont les triangles d'un maillage
+    // indexé : triangleIndices donne l'indice dans mesh du triangle de chaque primitive.
+    // Le maillage doit survivre au BVH
+    BVH(std::vector<LinearBVHNode> nodes, std::vector<uint32_t> triangleIndices, const Mesh& mesh,
+        const BVHBuildOptions& options);
+
+    // Intersection la plus proche du rayon dans l'intervalle [ray.tMin, ray.tMax[.
+    // Les enfants sont visités du plus proche au plus lointain et les sous-arbres
+    // situés au-delà de l'intersection courante sont ignorés
+    Intersection getIntersection(const Ray& ray) const override;
+    Intersection getIntersection(const Vector3& P, const Vector3& v,
+                                 double tMin = Scene::EPSILON,
+                                 double tMax = std::numeric_limits<double>::infinity()) const;
+
+    // Intersections les plus proches d'un paquet de count rayons voisins (au plus
+    // MAX_PACKET_SIZE), typiquement les rayons primaires d'un carré de pixels :
+    // hits[i] reçoit le même résultat que getIntersection(rays[i]).
+    // Les rayons descendent l'arbre binaire ensemble avec une pile commune ; le
+    // frustum du paquet écarte les nœuds qu'aucun rayon ne peut toucher, puis la
+    // boîte est testée quatre rayons par instruction. Quand il ne reste presque plus
+    // de rayons actifs dans un sous-arbre, chacun le termine seul. Les paquets dont
+    // les directions changent de signe et les dispositions larges ou quantifiées sont
+    // tracés rayon par rayon
+    void getIntersections(const Ray* rays, int count, Intersection* hits) const override;
+
+    // Requête any-hit pour les rayons d'ombre : vrai dès qu'une primitive coupe le
+    // rayon dans [ray.tMin, ray.tMax[, sans calcul de normale ni recherche du plus proche
+    bool occluded(const Ray& ray) const override;
+    bool occluded(const Vector3& P, const Vector3& v,
+                  double tMin = Scene::EPSILON,
+                  double tMax = std::numeric_limits<double>::infinity()) const;
+
+    // Requête all-hits : un seul parcours appelle callback pour chaque intersection
+    // dans [ray.tMin, ray.tMax[, dans l'ordre du parcours. Renvoie false si callback a
+    // interrompu le parcours
+    bool forEachHit(const Ray& ray, const IntersectionCallback& callback) const override;
+    bool forEachHit(const Vector3& P, const Vector3& v, double tMin, double tMax,
+                    const IntersectionCallback& callback) const;
+
+    // Recalcule les boîtes de bas en haut après déplacement des primitives, sans
+    // changer la topologie de l'arbre. Les feuilles d'un SBVH reprennent la boîte
+    // entière de leur primitive, plus lâche que la boîte rognée d'origine.
+    // Renvoie la dégradation (voir getRefitDegradation)
+    double refit();
+
+    // Refit, puis reconstruction complète si la dégradation dépasse rebuildThreshold.
+    // Renvoie vrai si l'arbre a été reconstruit. Un BVH de maillage n'est jamais reconstruit
+    bool update(double rebuildThreshold = DEFAULT_REBUILD_THRESHOLD) override;
+
+    // Insère une forme sans reconstruire l'arbre : sa feuille devient la sœur du nœud
+    // qui augmente le moins le coût SAH, trouvé par séparation et évaluation (Bittner
+    // et al. 2013), puis les boîtes des ancêtres sont élargies. Si l'arbre devient trop
+    // profond pour la pile de parcours, il est reconstruit. insert() et remove()
+    // lèvent une exception sur le BVH d'un maillage
+    void insert(const std::shared_ptr<Shape>& shape) override;
+
+    // Retire toutes les références à la forme : une feuille vidée disparaît avec son
+    // parent, remplacé par le nœud frère, et les boîtes des ancêtres sont resserrées.
+    // Insertions et retraits dégradent l'arbre comme un refit : getRefitDegradation
+    // les compare toujours à la dernière construction
+    bool remove(const std::shared_ptr<Shape>& shape) override;
+
+    // Rapport entre le coût SAH actuel et celui de l'arbre à sa construction (1 = intact)
+    double getRefitDegradation() const;
+
+    // Vrai si la dégradation dépasse rebuildThreshold ; jamais pour un BVH de maillage
+    bool needsRebuild(double rebuildThreshold) const override {
+        return !mesh && getRefitDegradation() > rebuildThreshold;
+    }
+
+    // Coût SAH de l'arbre linéarisé, normalisé par l'aire de la racine
+    double getSAHCost() const;
+
+    AcceleratorType getType() const override { return AcceleratorType::BVH; }
+    const char* getName() const override { return "BVH"; }
+    AABB getBounds() const override;
+    size_t getNodeCount() const { return nodes.size(); }
+    const std::vector<LinearBVHNode>& getNodes() const { return nodes; }
+    const std::vector<std::shared_ptr<Shape>>& getPrimitives() const { return primitives; }
+    const std::vector<uint32_t>& getTriangleIndices() const { return triangleIndices; }
+    const BVHStats& getStats() const override { return stats; }
+
+private:
+    // Statistiques et dispositions d'un arbre repris tel quel ; uniqueCount est le nombre
+    // de primitives distinctes
+    void initLoadedTree(size_t uniqueCount);
+
+    // Reconstruction complète sur les formes distinctes de l'arbre, mêmes options
+    void rebuild();
+
+    // Accès à la primitive d'indice reference, forme ou triangle du maillage : même
+    // contrat que Shape::getIntersection (distance au moins Scene::EPSILON), les triangles
+    // au-delà de tMax étant écartés sans calculer leur normale
+    Intersection intersectPrimitive(uint32_t reference, const Ray& ray, double tMax) const;
+    bool primitiveOccludes(uint32_t reference, const Ray& ray) const;
+    bool forEachPrimitiveHit(uint32_t reference, const Ray& ray, const IntersectionCallback& callback) const;
+    AABB getPrimitiveBounds(uint32_t reference) const;
+
+    // Identifiant de la primitive, commun à toutes ses références (SBVH)
+    uintptr_t getPrimitiveId(uint32_t reference) const;
+
+    // Aplatissement récursif de l'arbre de construction, renvoie l'indice du nœud créé
+    uint32_t flatten(const BVHNode& node);
+
+    // Nœud dont la boîte, réunie à box, donne le plus petit coût SAH induit : aire du
+    // nouveau parent plus agrandissement de tous ses ancêtres
+    uint32_t findBestSibling(const AABB& box) const;
+
+    // Ancêtres du nœud index, de la racine à son parent
+    std::vector<uint32_t> getAncestors(uint32_t index) const;
+
+    // Fin (exclue) de la plage contiguë de nœuds occupée par le sous-arbre de index
+    uint32_t getSubtreeEnd(uint32_t index) const;
+
+    // Recalcule la boîte de chacun des nœuds donnés, du dernier au premier
+    void refitNodes(const std::vector<uint32_t>& path);
+
+    // Retire primitives[reference] de sa feuille, et la feuille si elle devient vide
+    void removeReference(uint32_t reference);
+
+    // Statistiques de l'arbre après une insertion ou un retrait
+    void updateEditStats();
+
+    // Profondeur de la feuille la plus profonde de l'arbre binaire
+    int computeMaxDepth() const;
+
+    // Recherche du plus proche pour un seul rayon dans le sous-arbre binaire de
+    // racine root ; tMax est resserrée à chaque intersection
+    void closestHitBinary(uint32_t root, const Ray& ray, double& tMax, Intersection& closest) const;
+
+    // Repli ou compression de l'arbre binaire selon options.layout, sans effet pour
+    // la disposition binaire
+    void buildLayoutNodes();
+
+    // Repli du sous-arbre binaire d'indice binaryIndex en nœuds à N enfants,
+    // renvoie l'indice du nœud large créé
+    template <int N>
+    uint32_t collapse(uint32_t binaryIndex, std::vector<WideBVHNode<N>>& wideNodes) const;
+
+    // Parcours de l'arbre large, mêmes contrats que les requêtes publiques ; tMax est
+    // la borne courante de la recherche du plus proche, resserrée à chaque intersection
+    template <int N>
+    void closestHitWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray,
+                        double& tMax, Intersection& closest) const;
+    template <int N>
+    bool occludedWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray) const;
+    template <int N>
+    bool forEachHitWide(const std::vector<WideBVHNode<N>>& wideNodes, const Ray& ray,
+                        const IntersectionCallback& callback) const;
+
+    // Compression du sous-arbre binaire interne d'indice binaryIndex, dont la boîte
+    // décodée est box (minima puis maxima), renvoie l'indice du nœud quantifié créé
+    template <typename T>
+    uint32_t quantize(uint32_t binaryIndex, const double box[6],
+                      std::vector<QuantizedBVHNode<T>>& quantizedNodes) const;
+
+    // Parcours de l'arbre quantifié, mêmes contrats que les requêtes publiques
+    template <typename T>
+    void closestHitQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray,
+                             double& tMax, Intersection& closest) const;
+    template <typename T>
+    bool occludedQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray) const;
+    template <typename T>
+    bool forEachHitQuantized(const std::vector<QuantizedBVHNode<T>>& quantizedNodes, const Ray& ray,
+                             const IntersectionCallback& callback) const;
+
+    std::vector<LinearBVHNode> nodes;
+    std::vector<WideBVHNode<4>> wide4Nodes;
+    std::vector<WideBVHNode<8>> wide8Nodes;
+    std::vector<QuantizedBVHNode<uint16_t>> quantized16Nodes;
+    std::vector<QuantizedBVHNode<uint8_t>> quantized8Nodes;
+    std::vector<std::shared_ptr<Shape>> primitives;
+    const Mesh* mesh = nullptr;            ///< Maillage dont les triangles sont les primitives, sinon nullptr
+    std::vector<uint32_t> triangleIndices; ///< BVH de maillage : triangle de chaque primitive, à la place de primitives
+    BVHBuildOptions options;
+    BVHStats stats;
+};
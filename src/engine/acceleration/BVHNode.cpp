@@ -3,83 +3,161 @@
 #include <limits>
 #include <algorithm>
 
-BVHNode::BVHNode(const std::vector<std::shared_ptr<Shape>>& shapes)
+#ifdef USE_TBB
+#include <tbb/task_group.h>
+#endif
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    double centroid(const Shape& shape, const int axis) {
+        const AABB& b = shape.getBoundingBox();
+        return (b.min[axis] + b.max[axis]) / 2.0;
+    }
+
+    struct SAHBin {
+        AABB bounds;
+        size_t count = 0;
+    };
+}
+
+BVHNode::BVHNode(std::vector<std::shared_ptr<Shape>>& shapes, const size_t begin, const size_t end,
+                 const BVHBuildOptions& options, const int depth)
 {
-    if (shapes.size() == 1) {
-        leafShape = shapes[0];
-        leafShape->setBoundingBox();
-        boundingBox = leafShape->getBoundingBox();
-    } else {
-        boundingBox = std::make_shared<BoundingBox>(computeBoundingBox(shapes));
-
-        Vector3 diag = boundingBox->getMax() - boundingBox->getMin();
-        int axis = (diag[0] > diag[1])
-            ? (diag[0] > diag[2] ? 0 : 2)
-            : (diag[1] > diag[2] ? 1 : 2);
-
-        auto sortedShapes = shapes;
-        std::sort(sortedShapes.begin(), sortedShapes.end(),
-            [axis](const std::shared_ptr<Shape>& a, const std::shared_ptr<Shape>& b) {
-                const double centerA = (a->getBoundingBox()->getMin()[axis] + a->getBoundingBox()->getMax()[axis]) / 2.0;
-                const double centerB = (b->getBoundingBox()->getMin()[axis] + b->getBoundingBox()->getMax()[axis]) / 2.0;
-                return centerA < centerB;
-            });
-
-        size_t mid = sortedShapes.size() / 2;
-        std::vector<std::shared_ptr<Shape>> leftShapes(sortedShapes.begin(), sortedShapes.begin() + mid);
-        std::vector<std::shared_ptr<Shape>> rightShapes(sortedShapes.begin() + mid, sortedShapes.end());
-
-        left = std::make_shared<BVHNode>(leftShapes);
-        right = std::make_shared<BVHNode>(rightShapes);
+    const size_t count = end - begin;
+    if (count == 1) {
+        leafShapes.push_back(shapes[begin]);
+        boundingBox = shapes[begin]->getBoundingBox();
+        return;
+    }
+
+    boundingBox = computeBoundingBox(shapes, begin, end);
+
+    size_t mid = begin;
+    double splitCost = INF;
+    if (options.splitMethod == BVHSplitMethod::SAH && depth < MAX_SAH_DEPTH) {
+        mid = splitSAH(shapes, begin, end, boundingBox, options, axis, splitCost);
+    }
+
+    // Feuille si la plage est assez petite et qu'aucune découpe ne coûte moins cher
+    // que de tester toutes ses formes ; la plage est contiguë dans shapes
+    if (count <= getMaxLeafSize(options) && options.leafCost * count <= splitCost) {
+        leafShapes.assign(shapes.begin() + begin, shapes.begin() + end);
+        return;
+    }
+
+    if (mid == begin) {
+        axis = boundingBox.getLongestAxis();
+        mid = splitMedian(shapes, begin, end, axis);
+    }
+
+    // Les deux moitiés sont disjointes dans shapes : elles peuvent être construites simultanément
+#ifdef USE_TBB
+    if (end - begin >= PARALLEL_BUILD_THRESHOLD) {
+        tbb::task_group group;
+        group.run([&] { left = std::make_shared<BVHNode>(shapes, begin, mid, options, depth + 1); });
+        right = std::make_shared<BVHNode>(shapes, mid, end, options, depth + 1);
+        group.wait();
+        return;
     }
+#endif
+
+    left = std::make_shared<BVHNode>(shapes, begin, mid, options, depth + 1);
+    right = std::make_shared<BVHNode>(shapes, mid, end, options, depth + 1);
 }
 
-Intersection BVHNode::getIntersection(const Vector3& P, const Vector3& v) const {
-    const Intersection boxHit = boundingBox->getIntersection(P, v);
-    bool inside = boundingBox->contains(P);
+size_t BVHNode::splitMedian(std::vector<std::shared_ptr<Shape>>& shapes, const size_t begin,
+                            const size_t end, const int axis)
+{
+    // Seule la position du médian importe : une sélection suffit, inutile de trier
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(shapes.begin() + begin, shapes.begin() + mid, shapes.begin() + end,
+        [axis](const std::shared_ptr<Shape>& a, const std::shared_ptr<Shape>& b) {
+            return centroid(*a, axis) < centroid(*b, axis);
+        });
+    return mid;
+}
 
-    if (boxHit.lambda < Scene::EPSILON && !inside) {
-        return Intersection();
+size_t BVHNode::splitSAH(std::vector<std::shared_ptr<Shape>>& shapes, const size_t begin, const size_t end,
+                         const AABB& bounds, const BVHBuildOptions& options, int& splitAxis,
+                         double& splitCost)
+{
+    // Boîte des centroïdes : c'est elle qui est découpée en bins
+    AABB centroidBounds;
+    for (size_t i = begin; i < end; ++i) {
+        centroidBounds.grow(shapes[i]->getBoundingBox().getCenter());
     }
+    const Vector3& cMin = centroidBounds.min;
+    const Vector3& cMax = centroidBounds.max;
 
-    if (leafShape != nullptr) {
-        Intersection inter = leafShape->getIntersection(P, v);
-        if (inter.lambda >= Scene::EPSILON) {
-            return inter;
-        }
-        return Intersection();
+    const int axis = centroidBounds.getLongestAxis();
+    const double extent = cMax[axis] - cMin[axis];
+    const double parentArea = bounds.getSurfaceArea();
+    const int binCount = std::max(2, options.binCount);
+
+    // Centroïdes confondus ou boîte infinie : le SAH n'a pas de sens
+    if (!(extent > 0.0) || !std::isfinite(extent) || !std::isfinite(parentArea) || parentArea <= 0.0) {
+        return begin;
     }
 
-    const Intersection hitLeft = left->getIntersection(P, v);
-    const Intersection hitRight = right->getIntersection(P, v);
+    auto binIndex = [&](const Shape& shape) {
+        const int b = static_cast<int>(binCount * (centroid(shape, axis) - cMin[axis]) / extent);
+        return std::clamp(b, 0, binCount - 1);
+    };
 
-    const bool leftHit = hitLeft.lambda >= Scene::EPSILON;
-    const bool rightHit = hitRight.lambda >= Scene::EPSILON;
+    std::vector<SAHBin> bins(binCount);
+    for (size_t i = begin; i < end; ++i) {
+        SAHBin& bin = bins[binIndex(*shapes[i])];
+        bin.bounds.grow(shapes[i]->getBoundingBox());
+        bin.count++;
+    }
 
-    if (leftHit && rightHit) {
-        return (hitLeft.lambda < hitRight.lambda) ? hitLeft : hitRight;
-    } else if (leftHit) {
-        return hitLeft;
-    } else {
-        return hitRight;
+    // Balayage de droite à gauche pour les aires/effectifs cumulés de droite
+    std::vector<double> rightArea(binCount, 0.0);
+    std::vector<size_t> rightCount(binCount, 0);
+    SAHBin acc;
+    for (int i = binCount - 1; i > 0; --i) {
+        acc.bounds.grow(bins[i].bounds);
+        acc.count += bins[i].count;
+        rightArea[i] = acc.count > 0 ? acc.bounds.getSurfaceArea() : 0.0;
+        rightCount[i] = acc.count;
     }
-}
 
-BoundingBox BVHNode::computeBoundingBox(const std::vector<std::shared_ptr<Shape>>& shapes) {
-    Vector3 min(std::numeric_limits<double>::infinity(),
-                std::numeric_limits<double>::infinity(),
-                std::numeric_limits<double>::infinity());
+    // Balayage de gauche à droite : évaluation du coût de chaque plan de découpe
+    double bestCost = INF;
+    int bestSplit = -1;
+    acc = SAHBin();
+    for (int i = 0; i < binCount - 1; ++i) {
+        acc.bounds.grow(bins[i].bounds);
+        acc.count += bins[i].count;
+        if (acc.count == 0 || rightCount[i + 1] == 0) continue;
 
-    Vector3 max(-std::numeric_limits<double>::infinity(),
-                -std::numeric_limits<double>::infinity(),
-                -std::numeric_limits<double>::infinity());
+        const double leftArea = acc.bounds.getSurfaceArea();
+        const double cost = options.traversalCost + options.leafCost *
+            (acc.count * leftArea + rightCount[i + 1] * rightArea[i + 1]) / parentArea;
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestSplit = i;
+        }
+    }
 
-    for (const auto& shape : shapes) {
-        shape->setBoundingBox();
-        const std::shared_ptr<BoundingBox> b = shape->getBoundingBox();
-        min = min.min(b->getMin());
-        max = max.max(b->getMax());
+    if (bestSplit < 0) {
+        return begin;
     }
 
-    return BoundingBox(min, max);
+    splitAxis = axis;
+    splitCost = bestCost;
+
+    const auto mid = std::partition(shapes.begin() + begin, shapes.begin() + end,
+        [&](const std::shared_ptr<Shape>& shape) { return binIndex(*shape) <= bestSplit; });
+    return static_cast<size_t>(mid - shapes.begin());
+}
+
+AABB BVHNode::computeBoundingBox(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                 const size_t begin, const size_t end) {
+    AABB bounds;
+    for (size_t i = begin; i < end; ++i) {
+        bounds.grow(shapes[i]->getBoundingBox());
+    }
+    return bounds;
 }
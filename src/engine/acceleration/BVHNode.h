@@ -1,26 +1,119 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <memory>
-#include "BoundingBox.h"
+#include "AABB.h"
 #include "../Vector.h"
 #include "../Intersection.h"
 #include "../shapes/Shape.h"
 
+/**
+ * Stratégie de découpe utilisée lors de la construction du BVH.
+ */
+enum class BVHSplitMethod {
+    Median, ///< Découpe au centroïde médian sur l'axe le plus long
+    SAH,    ///< Surface Area Heuristic évaluée sur des bins
+    LBVH,   ///< Tri par codes de Morton puis découpe sur leurs bits, linéaire (voir LBVHBuilder)
+    HLBVH,  ///< Grappes LBVH assemblées par un SAH au sommet de l'arbre
+    SBVH    ///< SAH avec découpes spatiales : les primitives chevauchantes sont découpées (voir SBVHBuilder)
+};
+
+/**
+ * Organisation mémoire du BVH parcouru par les rayons.
+ */
+enum class BVHLayout {
+    Binary, ///< Arbre binaire, un test de boîte par enfant
+    Wide4,  ///< Arbre à 4 enfants testés ensemble (un registre AVX par plan)
+    Wide8,  ///< Arbre à 8 enfants testés ensemble (deux registres AVX par plan)
+    Quantized16, ///< Arbre binaire compressé, boîtes des enfants sur 16 bits relatives au parent
+    Quantized8   ///< Arbre binaire compressé, boîtes des enfants sur 8 bits relatives au parent
+};
+
+/**
+ * Ordre des nœuds dans le tableau aplati. Dans les deux cas un nœud interne est
+ * suivi de son premier enfant, que le parcours atteint sans saut en mémoire.
+ */
+enum class BVHNodeOrder {
+    DepthFirst,      ///< Profondeur d'abord, enfant gauche (côté bas de la découpe) en premier
+    LargerChildFirst ///< Profondeur d'abord, enfant de plus grande aire (le plus souvent traversé) en premier
+};
+
+/**
+ * Paramètres de construction du BVH.
+ */
+struct BVHBuildOptions {
+    BVHSplitMethod splitMethod = BVHSplitMethod::SAH;
+    int binCount = 12;          ///< Nombre de bins évalués par le SAH
+    double traversalCost = 1.0; ///< Coût relatif d'un test de boîte
+    double leafCost = 1.0;      ///< Coût relatif d'un test de primitive dans une feuille
+    BVHLayout layout = BVHLayout::Binary; ///< Arbre binaire aplati ou arbre large replié
+    double spatialSplitAlpha = 1e-5;  ///< SBVH : recouvrement minimal des enfants (rapporté à l'aire de la racine) pour tenter une découpe spatiale
+    double duplicationBudget = 0.3;   ///< SBVH : références supplémentaires autorisées, en fraction du nombre de primitives
+    int maxLeafSize = 4;        ///< Nombre maximal de primitives par feuille (1 : une feuille par primitive), borné à BVHNode::MAX_LEAF_SIZE
+    BVHNodeOrder nodeOrder = BVHNodeOrder::LargerChildFirst; ///< Ordre des nœuds à l'aplatissement
+};
+
+/**
+ * Nœud de l'arbre de construction du BVH. L'arbre est ensuite aplati par BVH
+ * et n'est pas utilisé pour le parcours des rayons.
+ *
+ * La construction réordonne en place la plage [begin, end[ du tableau de formes
+ * fourni : chaque découpe partitionne la plage au lieu de copier deux nouveaux
+ * vecteurs. Avec TBB, les sous-arbres assez gros sont construits en parallèle.
+ * Les boîtes englobantes des formes doivent être à jour avant la construction.
+ *
+ * Une plage d'au plus maxLeafSize formes devient une feuille lorsque le SAH juge
+ * son coût d'intersection inférieur à celui de la meilleure découpe.
+ */
 class BVHNode {
 public:
-    // Constructeur récursif
-    explicit BVHNode(const std::vector<std::shared_ptr<Shape>>& shapes);
+    // Au-delà de cette profondeur on découpe à la médiane pour borner la hauteur de l'arbre
+    static constexpr int MAX_SAH_DEPTH = 64;
 
-    // Intersection d'un rayon avec le nœud BVH
-    Intersection getIntersection(const Vector3& P, const Vector3& v) const;
+    // En dessous de ce nombre de formes, un sous-arbre est construit sur le thread courant
+    static constexpr size_t PARALLEL_BUILD_THRESHOLD = 4096;
+
+    // Le nœud linéarisé code le nombre de primitives d'une feuille sur 16 bits
+    static constexpr size_t MAX_LEAF_SIZE = std::numeric_limits<uint16_t>::max();
+
+    // maxLeafSize des options ramené dans [1, MAX_LEAF_SIZE], commun à tous les constructeurs
+    static size_t getMaxLeafSize(const BVHBuildOptions& options) {
+        return std::min(static_cast<size_t>(std::max(1, options.maxLeafSize)), MAX_LEAF_SIZE);
+    }
+
+    // Constructeur récursif sur la plage [begin, end[ de shapes, réordonnée en place
+    BVHNode(std::vector<std::shared_ptr<Shape>>& shapes, size_t begin, size_t end,
+            const BVHBuildOptions& options = {}, int depth = 0);
 
 private:
-    // Calcul du BoundingBox englobant toutes les formes
-    BoundingBox computeBoundingBox(const std::vector<std::shared_ptr<Shape>>& shapes);
+    friend class BVH;
+    friend class LBVHBuilder;
+    friend class SBVHBuilder;
+
+    // Nœud assemblé directement par LBVHBuilder
+    BVHNode() = default;
+
+    // Calcul de la boîte englobant les formes de la plage
+    static AABB computeBoundingBox(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                          size_t begin, size_t end);
+
+    // Découpe au centroïde médian sur l'axe donné, renvoie l'indice de séparation
+    static size_t splitMedian(std::vector<std::shared_ptr<Shape>>& shapes, size_t begin, size_t end,
+                              int axis);
+
+    // Découpe SAH par bins, renvoie l'indice de séparation ou begin si aucune
+    // découpe valide n'a été trouvée ; splitCost reçoit le coût SAH de la découpe
+    static size_t splitSAH(std::vector<std::shared_ptr<Shape>>& shapes, size_t begin, size_t end,
+                           const AABB& bounds, const BVHBuildOptions& options, int& splitAxis,
+                           double& splitCost);
 
-    std::shared_ptr<BoundingBox> boundingBox;
+    AABB boundingBox;
     std::shared_ptr<BVHNode> left = nullptr;
     std::shared_ptr<BVHNode> right = nullptr;
-    std::shared_ptr<Shape> leafShape = nullptr;
+    std::vector<std::shared_ptr<Shape>> leafShapes; ///< Formes d'une feuille, vide pour un nœud interne
+    int axis = 0;
 };
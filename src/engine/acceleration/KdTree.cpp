@@ -0,0 +1,320 @@
+#include "KdTree.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Découpes successives sans gain tolérées avant de créer une feuille
+    constexpr int MAX_BAD_REFINES = 3;
+
+    // Bord d'une boîte de primitive le long de l'axe évalué
+    struct BoundEdge {
+        double t;
+        uint32_t primitive;
+        bool isStart;
+
+        // À position égale, les débuts passent avant les fins
+        bool operator<(const BoundEdge& other) const {
+            return t != other.t ? t < other.t : isStart && !other.isStart;
+        }
+    };
+
+    struct StackEntry {
+        uint32_t node;
+        double tMin;
+        double tMax;
+    };
+}
+
+KdTree::KdTree(const std::vector<std::shared_ptr<Shape>>& shapes, const KdTreeBuildOptions& options)
+    : shapes(shapes), options(options)
+{
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+
+    primitives = partitionShapes(shapes);
+    stats.unboundedCount = unboundedPrimitives.size();
+
+    if (primitives.empty()) {
+        bounds = AABB(Vector3(0, 0, 0), Vector3(0, 0, 0));
+        return;
+    }
+
+    for (const auto& shape : primitives) {
+        bounds.grow(shape->getBoundingBox());
+    }
+    const double margin = getBoundsMargin(bounds);
+    const Vector3 padding(margin, margin, margin);
+    bounds = AABB(bounds.min - padding, bounds.max + padding);
+
+    primitiveBounds.reserve(primitives.size());
+    for (const auto& shape : primitives) {
+        const AABB& box = shape->getBoundingBox();
+        primitiveBounds.emplace_back(box.min - padding, box.max + padding);
+    }
+
+    int maxDepth = options.maxDepth;
+    if (maxDepth <= 0) {
+        maxDepth = static_cast<int>(std::round(8.0 + 1.3 * std::log2(static_cast<double>(primitives.size()))));
+    }
+    maxDepth = std::min(maxDepth, MAX_DEPTH);
+
+    std::vector<uint32_t> references(primitives.size());
+    for (size_t i = 0; i < references.size(); ++i) {
+        references[i] = static_cast<uint32_t>(i);
+    }
+    build(bounds, references, maxDepth, 0);
+
+    stats.nodeCount = nodes.size();
+    for (const KdTreeNode& node : nodes) {
+        if (node.isLeaf()) {
+            stats.leafCount++;
+        }
+    }
+    stats.primitiveCount = primitiveIndices.size();
+    stats.bytes = nodes.size() * sizeof(KdTreeNode) + primitiveIndices.size() * sizeof(uint32_t);
+
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    stats.buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+}
+
+void KdTree::build(const AABB& nodeBounds, std::vector<uint32_t>& references, const int depth, int badRefines) {
+    const size_t count = references.size();
+    if (count <= static_cast<size_t>(options.maxLeafSize) || depth == 0) {
+        makeLeaf(references);
+        return;
+    }
+
+    // Coût SAH de chaque plan candidat : les bords des boîtes sur l'axe le plus long,
+    // puis sur les autres axes si aucun n'est à l'intérieur du nœud
+    const Vector3 d = nodeBounds.getExtent();
+    const double invArea = 1.0 / nodeBounds.getSurfaceArea();
+    const double leafCost = options.intersectionCost * static_cast<double>(count);
+
+    // Arêtes triées de chaque axe évalué, gardées pour la répartition
+    std::vector<BoundEdge> edges[3];
+    double bestCost = INF;
+    int bestAxis = -1;
+    size_t bestOffset = 0;
+
+    int axis = nodeBounds.getLongestAxis();
+    for (int retries = 0; retries < 3 && bestAxis == -1; ++retries, axis = (axis + 1) % 3) {
+        std::vector<BoundEdge>& axisEdges = edges[axis];
+        axisEdges.resize(2 * count);
+        for (size_t i = 0; i < count; ++i) {
+            const AABB& box = primitiveBounds[references[i]];
+            axisEdges[2 * i] = {box.min[axis], references[i], true};
+            axisEdges[2 * i + 1] = {box.max[axis], references[i], false};
+        }
+        std::sort(axisEdges.begin(), axisEdges.end());
+
+        const int axis0 = (axis + 1) % 3;
+        const int axis1 = (axis + 2) % 3;
+        size_t below = 0;
+        size_t above = count;
+        for (size_t i = 0; i < 2 * count; ++i) {
+            if (!axisEdges[i].isStart) --above;
+
+            const double t = axisEdges[i].t;
+            if (t > nodeBounds.min[axis] && t < nodeBounds.max[axis]) {
+                const double belowArea = 2.0 * (d[axis0] * d[axis1] + (t - nodeBounds.min[axis]) * (d[axis0] + d[axis1]));
+                const double aboveArea = 2.0 * (d[axis0] * d[axis1] + (nodeBounds.max[axis] - t) * (d[axis0] + d[axis1]));
+                const double bonus = (below == 0 || above == 0) ? options.emptyBonus : 0.0;
+                const double cost = options.traversalCost + options.intersectionCost * (1.0 - bonus)
+                    * (belowArea * invArea * below + aboveArea * invArea * above);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestOffset = i;
+                }
+            }
+
+            if (axisEdges[i].isStart) ++below;
+        }
+    }
+
+    if (bestCost > leafCost) {
+        ++badRefines;
+    }
+    if (bestAxis == -1 || badRefines == MAX_BAD_REFINES || (bestCost > 4.0 * leafCost && count < 16)) {
+        makeLeaf(references);
+        return;
+    }
+
+    // Les primitives qui commencent avant le plan vont en bas, celles qui finissent
+    // après en haut ; celles qui le traversent vont des deux côtés
+    const std::vector<BoundEdge>& bestEdges = edges[bestAxis];
+    std::vector<uint32_t> belowReferences;
+    std::vector<uint32_t> aboveReferences;
+    for (size_t i = 0; i < bestOffset; ++i) {
+        if (bestEdges[i].isStart) belowReferences.push_back(bestEdges[i].primitive);
+    }
+    for (size_t i = bestOffset + 1; i < 2 * count; ++i) {
+        if (!bestEdges[i].isStart) aboveReferences.push_back(bestEdges[i].primitive);
+    }
+    const double split = bestEdges[bestOffset].t;
+
+    // Mémoire rendue avant de descendre : seules les références des enfants restent
+    for (std::vector<BoundEdge>& axisEdges : edges) {
+        std::vector<BoundEdge>().swap(axisEdges);
+    }
+    std::vector<uint32_t>().swap(references);
+
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    AABB belowBounds = nodeBounds;
+    AABB aboveBounds = nodeBounds;
+    belowBounds.max[bestAxis] = split;
+    aboveBounds.min[bestAxis] = split;
+
+    build(belowBounds, belowReferences, depth - 1, badRefines);
+    const uint32_t aboveChild = static_cast<uint32_t>(nodes.size());
+    build(aboveBounds, aboveReferences, depth - 1, badRefines);
+
+    KdTreeNode& node = nodes[index];
+    node.split = split;
+    node.child = aboveChild;
+    node.flags = static_cast<uint32_t>(bestAxis);
+}
+
+void KdTree::makeLeaf(const std::vector<uint32_t>& references) {
+    KdTreeNode leaf;
+    leaf.split = 0.0;
+    leaf.child = static_cast<uint32_t>(primitiveIndices.size());
+    leaf.flags = (static_cast<uint32_t>(references.size()) << 2) | KdTreeNode::LEAF;
+    nodes.push_back(leaf);
+    primitiveIndices.insert(primitiveIndices.end(), references.begin(), references.end());
+}
+
+template <typename Visitor>
+bool KdTree::traverse(const Ray& ray, const double& tMax, Visitor&& visit) const {
+    if (nodes.empty()) {
+        return true;
+    }
+
+    double tNodeMin, tNodeMax;
+    if (!bounds.intersect(ray, tNodeMin, tNodeMax)) {
+        return true;
+    }
+    tNodeMax = std::min(tNodeMax, tMax);
+
+    StackEntry stack[MAX_DEPTH + 1];
+    int stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        // Nœud situé au-delà de l'intersection la plus proche : les suivants aussi
+        if (tMax < tNodeMin) {
+            return true;
+        }
+
+        const KdTreeNode& node = nodes[current];
+        if (!node.isLeaf()) {
+            const int axis = node.getAxis();
+            const double tPlane = (node.split - ray.origin[axis]) * ray.invDirection[axis];
+
+            // L'enfant du côté de l'origine est traversé en premier
+            const bool belowFirst = ray.origin[axis] < node.split
+                || (ray.origin[axis] == node.split && ray.direction[axis] <= 0.0);
+            const uint32_t first = belowFirst ? current + 1 : node.child;
+            const uint32_t second = belowFirst ? node.child : current + 1;
+
+            // Un rayon parallèle au plan (tPlane NaN ou infini) reste du côté de son origine
+            if (!(tPlane <= tNodeMax) || tPlane <= 0.0) {
+                current = first;
+            } else if (tPlane < tNodeMin) {
+                current = second;
+            } else {
+                stack[stackSize++] = {second, tPlane, tNodeMax};
+                current = first;
+                tNodeMax = tPlane;
+            }
+            continue;
+        }
+
+        if (node.getPrimitiveCount() > 0 && !visit(node, tNodeMin, tNodeMax)) {
+            return false;
+        }
+
+        if (stackSize == 0) {
+            return true;
+        }
+        const StackEntry& entry = stack[--stackSize];
+        current = entry.node;
+        tNodeMin = entry.tMin;
+        tNodeMax = entry.tMax;
+    }
+}
+
+Intersection KdTree::getIntersection(const Ray& ray) const {
+    double tMax = ray.tMax;
+    Intersection closest = intersectUnbounded(ray, tMax);
+
+    traverse(ray, tMax, [&](const KdTreeNode& leaf, double, double) {
+        for (uint32_t i = leaf.child; i < leaf.child + leaf.getPrimitiveCount(); ++i) {
+            const Intersection inter = primitives[primitiveIndices[i]]->getIntersection(ray.origin, ray.direction,
+                                                                                        ray.tMin, tMax);
+            if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+                closest = inter;
+                tMax = inter.lambda;
+            }
+        }
+        return true;
+    });
+
+    return closest;
+}
+
+bool KdTree::occluded(const Ray& ray) const {
+    if (unboundedOccluded(ray)) {
+        return true;
+    }
+
+    return !traverse(ray, ray.tMax, [&](const KdTreeNode& leaf, double, double) {
+        for (uint32_t i = leaf.child; i < leaf.child + leaf.getPrimitiveCount(); ++i) {
+            if (primitives[primitiveIndices[i]]->hasIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool KdTree::forEachHit(const Ray& ray, const IntersectionCallback& callback) const {
+    if (!forEachUnboundedHit(ray, callback)) {
+        return false;
+    }
+
+    return traverse(ray, ray.tMax, [&](const KdTreeNode& leaf, const double tLeafMin, const double tLeafMax) {
+        for (uint32_t i = leaf.child; i < leaf.child + leaf.getPrimitiveCount(); ++i) {
+            if (!primitives[primitiveIndices[i]]->forEachIntersection(ray.origin, ray.direction,
+                                                                     tLeafMin, tLeafMax, callback)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool KdTree::update(double) {
+    *this = KdTree(shapes, options);
+    return true;
+}
+
+void KdTree::insert(const std::shared_ptr<Shape>& shape) {
+    shapes.push_back(shape);
+    *this = KdTree(shapes, options);
+}
+
+bool KdTree::remove(const std::shared_ptr<Shape>& shape) {
+    const auto it = std::find(shapes.begin(), shapes.end(), shape);
+    if (it == shapes.end()) {
+        return false;
+    }
+    shapes.erase(it);
+    *this = KdTree(shapes, options);
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Accelerator.h"
+
+/**
+ * Nœud compact de l'arbre kd : 16 octets, quatre nœuds par ligne de cache.
+ * Un nœud interne est immédiatement suivi de son enfant bas (côté inférieur au
+ * plan de découpe) ; l'enfant haut est désigné par child. Une feuille référence
+ * la plage [child, child + getPrimitiveCount()[ du tableau d'indices de primitives.
+ */
+struct KdTreeNode {
+    static constexpr uint32_t LEAF = 3;
+
+    double split;   ///< Nœud interne : position du plan de découpe
+    uint32_t child; ///< Nœud interne : indice de l'enfant haut ; feuille : début de sa plage
+    uint32_t flags; ///< 2 bits de poids faible : axe de découpe, ou LEAF ; au-dessus : nombre de primitives
+
+    bool isLeaf() const { return (flags & 3) == LEAF; }
+    int getAxis() const { return static_cast<int>(flags & 3); }
+    uint32_t getPrimitiveCount() const { return flags >> 2; }
+};
+static_assert(sizeof(KdTreeNode) == 16, "KdTreeNode doit tenir sur 16 octets");
+
+/**
+ * Paramètres de construction de l'arbre kd.
+ */
+struct KdTreeBuildOptions {
+    double traversalCost = 1.0;     ///< Coût relatif de la traversée d'un nœud
+    double intersectionCost = 4.0;  ///< Coût relatif d'un test de primitive
+    double emptyBonus = 0.5;        ///< Réduction du coût d'une découpe qui isole un enfant vide
+    int maxLeafSize = 2;            ///< En dessous, la plage devient une feuille sans évaluer de découpe
+    int maxDepth = 0;               ///< Profondeur maximale (au plus MAX_DEPTH), 0 : 8 + 1.3 log2(N) (Pharr et al.)
+};
+
+/**
+ * Arbre kd construit par SAH : chaque nœud coupe l'espace par un plan aligné sur un
+ * axe, choisi parmi les bords des boîtes des primitives en minimisant le coût SAH
+ * (balayage des événements triés, O(N log² N)). Contrairement au BVH, les enfants ne
+ * se chevauchent pas : un rayon visite les feuilles dans l'ordre le long de son
+ * parcours et s'arrête à la première qui contient une intersection, au prix de
+ * primitives référencées par plusieurs feuilles.
+ */
+class KdTree : public Accelerator {
+public:
+    // Borne de la profondeur, qui fixe la taille de la pile de parcours
+    static constexpr int MAX_DEPTH = 64;
+
+    explicit KdTree(const std::vector<std::shared_ptr<Shape>>& shapes, const KdTreeBuildOptions& options = {});
+
+    AcceleratorType getType() const override { return AcceleratorType::KdTree; }
+    const char* getName() const override { return "Kd-tree"; }
+
+    Intersection getIntersection(const Ray& ray) const override;
+    bool occluded(const Ray& ray) const override;
+    bool forEachHit(const Ray& ray, const IntersectionCallback& callback) const override;
+
+    // L'arbre kd n'a pas de refit : il est toujours reconstruit, y compris après un
+    // ajout ou un retrait de forme
+    bool update(double rebuildThreshold) override;
+    void insert(const std::shared_ptr<Shape>& shape) override;
+    bool remove(const std::shared_ptr<Shape>& shape) override;
+
+    // Chaque modification reconstruit déjà l'arbre
+    bool needsRebuild(double) const override { return false; }
+
+    AABB getBounds() const override { return bounds; }
+    const AcceleratorStats& getStats() const override { return stats; }
+    const std::vector<KdTreeNode>& getNodes() const { return nodes; }
+
+private:
+    // Construction récursive du nœud couvrant nodeBounds et les primitives d'indices
+    // references ; badRefines compte les découpes successives qui n'ont pas fait
+    // baisser le coût, tolérées un temps pour sortir d'un minimum local
+    void build(const AABB& nodeBounds, std::vector<uint32_t>& references, int depth, int badRefines);
+
+    // Crée une feuille référençant les primitives d'indices references
+    void makeLeaf(const std::vector<uint32_t>& references);
+
+    // Visite dans l'ordre les feuilles non vides traversées par le rayon entre ray.tMin
+    // et tMax : visit(leaf, tEnter, tExit) renvoie false pour arrêter le parcours.
+    // tMax est relue à chaque nœud, pour que la recherche du plus proche écarte ceux
+    // situés au-delà de l'intersection courante. Renvoie false si visit a arrêté le parcours
+    template <typename Visitor>
+    bool traverse(const Ray& ray, const double& tMax, Visitor&& visit) const;
+
+    std::vector<std::shared_ptr<Shape>> shapes; ///< Formes d'origine, pour la reconstruction
+    std::vector<std::shared_ptr<Shape>> primitives;
+    std::vector<AABB> primitiveBounds;
+    std::vector<KdTreeNode> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    AABB bounds;
+    KdTreeBuildOptions options;
+    AcceleratorStats stats;
+};
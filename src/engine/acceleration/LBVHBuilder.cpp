@@ -0,0 +1,279 @@
+#include "LBVHBuilder.h"
+#include <limits>
+#include <algorithm>
+#include <array>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#endif
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Nombre de bits triés par passe du radix sort
+    constexpr int RADIX_BITS = 8;
+    constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+    // Taille minimale d'un bloc traité par une tâche du radix sort
+    constexpr size_t RADIX_CHUNK_SIZE = 1 << 14;
+
+    // Au-delà de cette profondeur, le sommet de l'arbre découpe les grappes par moitié
+    constexpr int MAX_UPPER_SAH_DEPTH = 16;
+    constexpr int UPPER_SAH_BINS = 12;
+
+    // Répartit les 21 bits de poids faible de v un bit sur trois
+    uint64_t spreadBits(uint64_t v) {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8) & 0x100f00f00f00f00full;
+        v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+
+    // Appelle fn(i) pour i dans [0, count[, en parallèle avec TBB
+    template <typename Fn>
+    void parallelFor(const size_t count, const Fn& fn) {
+#ifdef USE_TBB
+        tbb::parallel_for(size_t(0), count, fn);
+#else
+        for (size_t i = 0; i < count; ++i) fn(i);
+#endif
+    }
+}
+
+std::shared_ptr<BVHNode> LBVHBuilder::build(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                            const BVHBuildOptions& options)
+{
+    const size_t count = shapes.size();
+
+    AABB centroidBounds;
+    for (const auto& shape : shapes) {
+        centroidBounds.grow(shape->getBoundingBox().getCenter());
+    }
+    const Vector3& cMin = centroidBounds.min;
+    const Vector3& cMax = centroidBounds.max;
+
+    // 10 bits par axe suffisent à séparer un million de centroïdes, 21 au-delà
+    const int bitsPerAxis = count <= MAX_30_BIT_PRIMITIVES ? 10 : 21;
+    const int codeBits = 3 * bitsPerAxis;
+    const double scale = static_cast<double>((1u << bitsPerAxis) - 1);
+    const Vector3 extent = cMax - cMin;
+
+    std::vector<MortonPrimitive> primitives(count);
+    parallelFor(count, [&](const size_t i) {
+        const Vector3 c = shapes[i]->getBoundingBox().getCenter();
+        uint64_t q[3];
+        for (int a = 0; a < 3; ++a) {
+            const double t = extent[a] > 0.0 ? (c[a] - cMin[a]) / extent[a] : 0.0;
+            q[a] = static_cast<uint64_t>(std::clamp(t, 0.0, 1.0) * scale);
+        }
+        primitives[i] = {(spreadBits(q[0]) << 2) | (spreadBits(q[1]) << 1) | spreadBits(q[2]),
+                         static_cast<uint32_t>(i)};
+    });
+
+    radixSort(primitives, codeBits);
+
+    const size_t maxLeafSize = BVHNode::getMaxLeafSize(options);
+    if (options.splitMethod != BVHSplitMethod::HLBVH || count <= 1) {
+        return emit(primitives, shapes, 0, count, codeBits - 1, maxLeafSize);
+    }
+
+    // Grappes : plages partageant les CLUSTER_BITS bits de poids fort du code
+    const uint64_t clusterMask = ((uint64_t(1) << CLUSTER_BITS) - 1) << (codeBits - CLUSTER_BITS);
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t begin = 0, end = 1; end <= count; ++end) {
+        if (end == count || (primitives[begin].code & clusterMask) != (primitives[end].code & clusterMask)) {
+            ranges.emplace_back(begin, end);
+            begin = end;
+        }
+    }
+
+    std::vector<std::shared_ptr<BVHNode>> clusters(ranges.size());
+    parallelFor(ranges.size(), [&](const size_t i) {
+        clusters[i] = emit(primitives, shapes, ranges[i].first, ranges[i].second, codeBits - CLUSTER_BITS - 1, maxLeafSize);
+    });
+
+    return buildUpperSAH(clusters, 0, clusters.size(), options, 0);
+}
+
+void LBVHBuilder::radixSort(std::vector<MortonPrimitive>& primitives, const int bitCount) {
+    const size_t count = primitives.size();
+    const size_t chunkCount = std::max<size_t>(1, count / RADIX_CHUNK_SIZE);
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    std::vector<MortonPrimitive> sorted(count);
+    std::vector<std::array<size_t, RADIX_BUCKETS>> offsets(chunkCount);
+
+    for (int shift = 0; shift < bitCount; shift += RADIX_BITS) {
+        // Histogramme de chaque bloc
+        parallelFor(chunkCount, [&](const size_t chunk) {
+            std::array<size_t, RADIX_BUCKETS>& histogram = offsets[chunk];
+            histogram.fill(0);
+            const size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                histogram[(primitives[i].code >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+        });
+
+        // Position de départ de chaque (bucket, bloc) : les blocs gardent leur ordre, le tri reste stable
+        size_t position = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+                const size_t n = offsets[chunk][bucket];
+                offsets[chunk][bucket] = position;
+                position += n;
+            }
+        }
+
+        parallelFor(chunkCount, [&](const size_t chunk) {
+            std::array<size_t, RADIX_BUCKETS>& next = offsets[chunk];
+            const size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                sorted[next[(primitives[i].code >> shift) & (RADIX_BUCKETS - 1)]++] = primitives[i];
+            }
+        });
+
+        primitives.swap(sorted);
+    }
+}
+
+std::shared_ptr<BVHNode> LBVHBuilder::emit(const std::vector<MortonPrimitive>& primitives,
+                                           const std::vector<std::shared_ptr<Shape>>& shapes,
+                                           const size_t begin, const size_t end, int bitIndex,
+                                           const size_t maxLeafSize)
+{
+    if (end - begin <= maxLeafSize) {
+        auto leaf = std::shared_ptr<BVHNode>(new BVHNode());
+        for (size_t i = begin; i < end; ++i) {
+            leaf->leafShapes.push_back(shapes[primitives[i].index]);
+        }
+        leaf->boundingBox = BVHNode::computeBoundingBox(leaf->leafShapes, 0, end - begin);
+        return leaf;
+    }
+
+    // Bit de poids fort qui sépare la plage : tous les codes partagent les bits au-dessus
+    while (bitIndex >= 0) {
+        const uint64_t mask = uint64_t(1) << bitIndex;
+        if ((primitives[begin].code & mask) != (primitives[end - 1].code & mask)) break;
+        --bitIndex;
+    }
+
+    size_t mid;
+    if (bitIndex < 0) {
+        // Codes identiques : découpe par moitié
+        mid = begin + (end - begin) / 2;
+    } else {
+        const uint64_t mask = uint64_t(1) << bitIndex;
+        mid = std::partition_point(primitives.begin() + begin, primitives.begin() + end,
+            [mask](const MortonPrimitive& p) { return (p.code & mask) == 0; }) - primitives.begin();
+    }
+
+    // Bits entrelacés x, y, z de poids fort à faible : le bit 3k + 2 est sur x
+    const int axis = bitIndex < 0 ? 0 : 2 - bitIndex % 3;
+
+    std::shared_ptr<BVHNode> left;
+    std::shared_ptr<BVHNode> right;
+#ifdef USE_TBB
+    if (end - begin >= BVHNode::PARALLEL_BUILD_THRESHOLD) {
+        tbb::task_group group;
+        group.run([&] { left = emit(primitives, shapes, begin, mid, bitIndex - 1, maxLeafSize); });
+        right = emit(primitives, shapes, mid, end, bitIndex - 1, maxLeafSize);
+        group.wait();
+        return makeInterior(std::move(left), std::move(right), axis);
+    }
+#endif
+    left = emit(primitives, shapes, begin, mid, bitIndex - 1, maxLeafSize);
+    right = emit(primitives, shapes, mid, end, bitIndex - 1, maxLeafSize);
+    return makeInterior(std::move(left), std::move(right), axis);
+}
+
+std::shared_ptr<BVHNode> LBVHBuilder::buildUpperSAH(std::vector<std::shared_ptr<BVHNode>>& clusters,
+                                                    const size_t begin, const size_t end,
+                                                    const BVHBuildOptions& options, const int depth)
+{
+    if (end - begin == 1) {
+        return clusters[begin];
+    }
+
+    AABB bounds;
+    AABB centroidBounds;
+    for (size_t i = begin; i < end; ++i) {
+        bounds.grow(clusters[i]->boundingBox);
+        centroidBounds.grow(clusters[i]->boundingBox.getCenter());
+    }
+    const Vector3& cMin = centroidBounds.min;
+    const Vector3& cMax = centroidBounds.max;
+
+    const int axis = centroidBounds.getLongestAxis();
+    const double extent = cMax[axis] - cMin[axis];
+    size_t mid = begin + (end - begin) / 2;
+
+    if (depth < MAX_UPPER_SAH_DEPTH && extent > 0.0) {
+        auto binIndex = [&](const BVHNode& node) {
+            const int b = static_cast<int>(UPPER_SAH_BINS * (node.boundingBox.getCenter()[axis] - cMin[axis]) / extent);
+            return std::clamp(b, 0, UPPER_SAH_BINS - 1);
+        };
+
+        struct Bin {
+            AABB bounds;
+            size_t count = 0;
+        };
+        Bin bins[UPPER_SAH_BINS];
+        for (size_t i = begin; i < end; ++i) {
+            Bin& bin = bins[binIndex(*clusters[i])];
+            bin.bounds.grow(clusters[i]->boundingBox);
+            bin.count++;
+        }
+
+        // Coût de chaque plan entre deux bins, évalué comme dans BVHNode::splitSAH
+        double bestCost = INF;
+        int bestSplit = -1;
+        for (int split = 0; split < UPPER_SAH_BINS - 1; ++split) {
+            Bin leftBin, rightBin;
+            for (int i = 0; i <= split; ++i) {
+                leftBin.bounds.grow(bins[i].bounds);
+                leftBin.count += bins[i].count;
+            }
+            for (int i = split + 1; i < UPPER_SAH_BINS; ++i) {
+                rightBin.bounds.grow(bins[i].bounds);
+                rightBin.count += bins[i].count;
+            }
+            if (leftBin.count == 0 || rightBin.count == 0) continue;
+
+            const double cost = options.traversalCost + options.leafCost *
+                (leftBin.count * leftBin.bounds.getSurfaceArea()
+                 + rightBin.count * rightBin.bounds.getSurfaceArea()) / bounds.getSurfaceArea();
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = split;
+            }
+        }
+
+        if (bestSplit >= 0) {
+            mid = std::partition(clusters.begin() + begin, clusters.begin() + end,
+                [&](const std::shared_ptr<BVHNode>& node) { return binIndex(*node) <= bestSplit; })
+                - clusters.begin();
+        }
+    }
+
+    if (mid == begin || mid == end) {
+        mid = begin + (end - begin) / 2;
+    }
+
+    return makeInterior(buildUpperSAH(clusters, begin, mid, options, depth + 1),
+                        buildUpperSAH(clusters, mid, end, options, depth + 1), axis);
+}
+
+std::shared_ptr<BVHNode> LBVHBuilder::makeInterior(std::shared_ptr<BVHNode> left,
+                                                   std::shared_ptr<BVHNode> right, const int axis)
+{
+    auto node = std::shared_ptr<BVHNode>(new BVHNode());
+    node->boundingBox = AABB::merge(left->boundingBox, right->boundingBox);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    node->axis = axis;
+    return node;
+}
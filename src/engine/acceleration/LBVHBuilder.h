@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include "BVHNode.h"
+#include "../shapes/Shape.h"
+
+/**
+ * Construction linéaire du BVH (LBVH) pour les très gros meshes.
+ * Les centroïdes sont quantifiés en codes de Morton (30 bits, ou 63 bits au-delà
+ * de MAX_30_BIT_PRIMITIVES primitives) triés par un radix sort parallèle, puis
+ * l'arbre est émis en découpant chaque plage sur le bit de poids fort qui y change.
+ * Avec BVHSplitMethod::HLBVH, les grappes partageant les CLUSTER_BITS bits de
+ * poids fort sont construites ainsi, puis assemblées par un SAH au sommet.
+ * Les boîtes englobantes des formes doivent être à jour avant la construction.
+ */
+class LBVHBuilder {
+public:
+    static constexpr size_t MAX_30_BIT_PRIMITIVES = 1 << 20;
+    static constexpr int CLUSTER_BITS = 12;
+
+    static std::shared_ptr<BVHNode> build(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                          const BVHBuildOptions& options);
+
+private:
+    struct MortonPrimitive {
+        uint64_t code;
+        uint32_t index;
+    };
+
+    // Radix sort LSD stable sur les bitCount bits de poids faible des codes
+    static void radixSort(std::vector<MortonPrimitive>& primitives, int bitCount);
+
+    // Émission du sous-arbre de la plage triée [begin, end[, en partant du bit bitIndex ;
+    // une plage d'au plus maxLeafSize primitives devient une feuille
+    static std::shared_ptr<BVHNode> emit(const std::vector<MortonPrimitive>& primitives,
+                                         const std::vector<std::shared_ptr<Shape>>& shapes,
+                                         size_t begin, size_t end, int bitIndex, size_t maxLeafSize);
+
+    // SAH par bins sur les racines des grappes [begin, end[, réordonnées en place
+    static std::shared_ptr<BVHNode> buildUpperSAH(std::vector<std::shared_ptr<BVHNode>>& clusters,
+                                                  size_t begin, size_t end,
+                                                  const BVHBuildOptions& options, int depth);
+
+    static std::shared_ptr<BVHNode> makeInterior(std::shared_ptr<BVHNode> left,
+                                                 std::shared_ptr<BVHNode> right, int axis);
+};
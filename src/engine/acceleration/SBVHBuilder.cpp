@@ -0,0 +1,372 @@
+#include "SBVHBuilder.h"
+#include "../shapes/Triangle.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#ifdef USE_TBB
+#include <tbb/task_group.h>
+#endif
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Les découpes spatiales bénéficient d'un échantillonnage plus fin que les découpes par objets
+    constexpr int SPATIAL_BIN_COUNT = 32;
+
+    template <typename B>
+    void setEmpty(B& b) {
+        for (int a = 0; a < 3; ++a) {
+            b.min[a] = INF;
+            b.max[a] = -INF;
+        }
+    }
+
+    template <typename B>
+    void growPoint(B& b, const double* p) {
+        for (int a = 0; a < 3; ++a) {
+            b.min[a] = std::min(b.min[a], p[a]);
+            b.max[a] = std::max(b.max[a], p[a]);
+        }
+    }
+
+    template <typename B>
+    void growBounds(B& b, const B& other) {
+        for (int a = 0; a < 3; ++a) {
+            b.min[a] = std::min(b.min[a], other.min[a]);
+            b.max[a] = std::max(b.max[a], other.max[a]);
+        }
+    }
+
+    template <typename B>
+    double surfaceArea(const B& b) {
+        const double dx = b.max[0] - b.min[0];
+        const double dy = b.max[1] - b.min[1];
+        const double dz = b.max[2] - b.min[2];
+        if (dx < 0.0 || dy < 0.0 || dz < 0.0) return 0.0;
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    template <typename B>
+    double overlapArea(const B& a, const B& b) {
+        B overlap;
+        for (int i = 0; i < 3; ++i) {
+            overlap.min[i] = std::max(a.min[i], b.min[i]);
+            overlap.max[i] = std::min(a.max[i], b.max[i]);
+        }
+        return surfaceArea(overlap);
+    }
+
+    template <typename B>
+    double centroid(const B& b, const int axis) {
+        return (b.min[axis] + b.max[axis]) / 2.0;
+    }
+
+    int longestAxis(const double* min, const double* max) {
+        const double d[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+        return (d[0] > d[1])
+            ? (d[0] > d[2] ? 0 : 2)
+            : (d[1] > d[2] ? 1 : 2);
+    }
+
+    template <typename B>
+    AABB toAABB(const B& b) {
+        return AABB(Vector3(b.min[0], b.min[1], b.min[2]), Vector3(b.max[0], b.max[1], b.max[2]));
+    }
+}
+
+std::shared_ptr<BVHNode> SBVHBuilder::build(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                            const BVHBuildOptions& options)
+{
+    SBVHBuilder builder(shapes, options);
+
+    std::vector<Reference> references(shapes.size());
+    Bounds rootBounds;
+    setEmpty(rootBounds);
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        const AABB& b = shapes[i]->getBoundingBox();
+        references[i].primitive = static_cast<uint32_t>(i);
+        for (int a = 0; a < 3; ++a) {
+            references[i].bounds.min[a] = b.min[a];
+            references[i].bounds.max[a] = b.max[a];
+        }
+        growBounds(rootBounds, references[i].bounds);
+    }
+    builder.rootArea = surfaceArea(rootBounds);
+
+    return builder.buildNode(references, 0);
+}
+
+SBVHBuilder::SBVHBuilder(const std::vector<std::shared_ptr<Shape>>& shapes, const BVHBuildOptions& options)
+    : options(options)
+{
+    primitives.resize(shapes.size());
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        Primitive& primitive = primitives[i];
+        primitive.shape = shapes[i];
+        const auto* triangle = dynamic_cast<const Triangle*>(shapes[i].get());
+        primitive.isTriangle = triangle != nullptr;
+        if (primitive.isTriangle) {
+            const std::vector<Vector3> vertices = triangle->getVertices();
+            for (int v = 0; v < 3; ++v) {
+                for (int a = 0; a < 3; ++a) primitive.vertices[v][a] = vertices[v][a];
+            }
+        }
+    }
+    remainingDuplicates = static_cast<long long>(options.duplicationBudget * static_cast<double>(shapes.size()));
+}
+
+std::shared_ptr<BVHNode> SBVHBuilder::buildNode(std::vector<Reference>& references, const int depth)
+{
+    auto node = std::shared_ptr<BVHNode>(new BVHNode());
+    const size_t count = references.size();
+
+    if (count == 1) {
+        node->leafShapes.push_back(primitives[references[0].primitive].shape);
+        node->boundingBox = toAABB(references[0].bounds);
+        return node;
+    }
+
+    Bounds nodeBounds, centroidBounds;
+    setEmpty(nodeBounds);
+    setEmpty(centroidBounds);
+    for (const Reference& reference : references) {
+        growBounds(nodeBounds, reference.bounds);
+        const double c[3] = {centroid(reference.bounds, 0), centroid(reference.bounds, 1), centroid(reference.bounds, 2)};
+        growPoint(centroidBounds, c);
+    }
+    node->boundingBox = toAABB(nodeBounds);
+
+    const double nodeArea = surfaceArea(nodeBounds);
+    const int binCount = std::max(2, options.binCount);
+    const int spatialBinCount = std::max(binCount, SPATIAL_BIN_COUNT);
+
+    struct Bin {
+        Bounds bounds;
+        size_t count = 0;   ///< Découpe par objets
+        size_t entries = 0; ///< Découpe spatiale : références commençant dans ce bin
+        size_t exits = 0;   ///< Découpe spatiale : références finissant dans ce bin
+    };
+
+    // Découpe par objets : SAH par bins sur l'axe le plus long des centroïdes
+    const int objectAxis = longestAxis(centroidBounds.min, centroidBounds.max);
+    const double cMin = centroidBounds.min[objectAxis];
+    const double cExtent = centroidBounds.max[objectAxis] - cMin;
+    auto objectBin = [&](const Reference& reference) {
+        const int b = static_cast<int>(binCount * (centroid(reference.bounds, objectAxis) - cMin) / cExtent);
+        return std::clamp(b, 0, binCount - 1);
+    };
+
+    double objectCost = INF;
+    int objectSplit = -1;
+    Bounds objectLeft, objectRight;
+    const bool canUseSAH = depth < BVHNode::MAX_SAH_DEPTH && cExtent > 0.0 && std::isfinite(cExtent)
+        && nodeArea > 0.0 && std::isfinite(nodeArea);
+
+    if (canUseSAH) {
+        std::vector<Bin> bins(binCount);
+        for (Bin& bin : bins) setEmpty(bin.bounds);
+        for (const Reference& reference : references) {
+            Bin& bin = bins[objectBin(reference)];
+            growBounds(bin.bounds, reference.bounds);
+            bin.count++;
+        }
+
+        std::vector<Bounds> rightBounds(binCount);
+        std::vector<size_t> rightCount(binCount, 0);
+        Bounds acc;
+        setEmpty(acc);
+        size_t accCount = 0;
+        for (int i = binCount - 1; i > 0; --i) {
+            growBounds(acc, bins[i].bounds);
+            accCount += bins[i].count;
+            rightBounds[i] = acc;
+            rightCount[i] = accCount;
+        }
+
+        setEmpty(acc);
+        accCount = 0;
+        for (int i = 0; i < binCount - 1; ++i) {
+            growBounds(acc, bins[i].bounds);
+            accCount += bins[i].count;
+            if (accCount == 0 || rightCount[i + 1] == 0) continue;
+
+            const double cost = options.traversalCost + options.leafCost *
+                (accCount * surfaceArea(acc) + rightCount[i + 1] * surfaceArea(rightBounds[i + 1])) / nodeArea;
+            if (cost < objectCost) {
+                objectCost = cost;
+                objectSplit = i;
+                objectLeft = acc;
+                objectRight = rightBounds[i + 1];
+            }
+        }
+    }
+
+    // Découpe spatiale, seulement si les enfants de la découpe par objets se recouvrent
+    double spatialCost = INF;
+    int spatialAxis = -1;
+    double spatialPlane = 0.0;
+    if (objectSplit >= 0 && remainingDuplicates > 0
+        && overlapArea(objectLeft, objectRight) > options.spatialSplitAlpha * rootArea) {
+        for (int axis = 0; axis < 3; ++axis) {
+            const double lo = nodeBounds.min[axis];
+            const double extent = nodeBounds.max[axis] - lo;
+            if (!(extent > 0.0)) continue;
+            const double binWidth = extent / spatialBinCount;
+            auto spatialBin = [&](const double x) {
+                return std::clamp(static_cast<int>((x - lo) / binWidth), 0, spatialBinCount - 1);
+            };
+
+            std::vector<Bin> bins(spatialBinCount);
+            for (Bin& bin : bins) setEmpty(bin.bounds);
+            for (const Reference& reference : references) {
+                const int first = spatialBin(reference.bounds.min[axis]);
+                const int last = spatialBin(reference.bounds.max[axis]);
+                for (int b = first; b <= last; ++b) {
+                    const double binLo = b == first ? -INF : lo + b * binWidth;
+                    const double binHi = b == last ? INF : lo + (b + 1) * binWidth;
+                    growBounds(bins[b].bounds, first == last ? reference.bounds : clip(reference, axis, binLo, binHi));
+                }
+                bins[first].entries++;
+                bins[last].exits++;
+            }
+
+            std::vector<Bounds> rightBounds(spatialBinCount);
+            std::vector<size_t> rightCount(spatialBinCount, 0);
+            Bounds acc;
+            setEmpty(acc);
+            size_t accCount = 0;
+            for (int i = spatialBinCount - 1; i > 0; --i) {
+                growBounds(acc, bins[i].bounds);
+                accCount += bins[i].exits;
+                rightBounds[i] = acc;
+                rightCount[i] = accCount;
+            }
+
+            setEmpty(acc);
+            accCount = 0;
+            for (int i = 0; i < spatialBinCount - 1; ++i) {
+                growBounds(acc, bins[i].bounds);
+                accCount += bins[i].entries;
+                // Chaque côté doit perdre au moins une référence pour que la récursion progresse
+                if (accCount == 0 || rightCount[i + 1] == 0 || accCount == count || rightCount[i + 1] == count) continue;
+
+                const double cost = options.traversalCost + options.leafCost *
+                    (accCount * surfaceArea(acc) + rightCount[i + 1] * surfaceArea(rightBounds[i + 1])) / nodeArea;
+                if (cost < spatialCost) {
+                    spatialCost = cost;
+                    spatialAxis = axis;
+                    spatialPlane = lo + (i + 1) * binWidth;
+                }
+            }
+        }
+    }
+
+    // Feuille si aucune découpe ne bat le test de toutes ses références ; deux
+    // références d'une même primitive finissent toujours dans des sous-arbres distincts
+    if (count <= BVHNode::getMaxLeafSize(options)
+        && options.leafCost * count <= std::min(objectCost, spatialCost)) {
+        for (const Reference& reference : references) {
+            node->leafShapes.push_back(primitives[reference.primitive].shape);
+        }
+        return node;
+    }
+
+    std::vector<Reference> left;
+    std::vector<Reference> right;
+
+    if (spatialAxis >= 0 && spatialCost < objectCost) {
+        node->axis = spatialAxis;
+        for (const Reference& reference : references) {
+            if (reference.bounds.max[spatialAxis] <= spatialPlane) {
+                left.push_back(reference);
+            } else if (reference.bounds.min[spatialAxis] >= spatialPlane) {
+                right.push_back(reference);
+            } else if (remainingDuplicates.fetch_sub(1) > 0) {
+                left.push_back({reference.primitive, clip(reference, spatialAxis, -INF, spatialPlane)});
+                right.push_back({reference.primitive, clip(reference, spatialAxis, spatialPlane, INF)});
+            } else {
+                // Budget épuisé : la référence entière va du côté de son centroïde
+                (centroid(reference.bounds, spatialAxis) < spatialPlane ? left : right).push_back(reference);
+            }
+        }
+    } else if (objectSplit >= 0) {
+        node->axis = objectAxis;
+        for (const Reference& reference : references) {
+            (objectBin(reference) <= objectSplit ? left : right).push_back(reference);
+        }
+    }
+
+    if (left.empty() || right.empty()) {
+        // Pas de découpe SAH possible : médiane des centroïdes sur l'axe le plus long
+        left.clear();
+        right.clear();
+        node->axis = objectAxis;
+        const size_t mid = count / 2;
+        std::nth_element(references.begin(), references.begin() + mid, references.end(),
+            [axis = objectAxis](const Reference& a, const Reference& b) {
+                return centroid(a.bounds, axis) < centroid(b.bounds, axis);
+            });
+        left.assign(references.begin(), references.begin() + mid);
+        right.assign(references.begin() + mid, references.end());
+    }
+
+    // Les références du parent ne servent plus : libérées avant la descente
+    std::vector<Reference>().swap(references);
+
+#ifdef USE_TBB
+    if (count >= BVHNode::PARALLEL_BUILD_THRESHOLD) {
+        tbb::task_group group;
+        group.run([&] { node->left = buildNode(left, depth + 1); });
+        node->right = buildNode(right, depth + 1);
+        group.wait();
+        return node;
+    }
+#endif
+
+    node->left = buildNode(left, depth + 1);
+    node->right = buildNode(right, depth + 1);
+    return node;
+}
+
+SBVHBuilder::Bounds SBVHBuilder::clip(const Reference& reference, const int axis, const double lo, const double hi) const
+{
+    Bounds clipped;
+    const Primitive& primitive = primitives[reference.primitive];
+
+    if (primitive.isTriangle) {
+        // Sommets dans la tranche et intersections des arêtes avec ses deux plans
+        setEmpty(clipped);
+        for (int e = 0; e < 3; ++e) {
+            const double* v0 = primitive.vertices[e];
+            const double* v1 = primitive.vertices[(e + 1) % 3];
+            if (v0[axis] >= lo && v0[axis] <= hi) growPoint(clipped, v0);
+
+            for (const double plane : {lo, hi}) {
+                if ((v0[axis] < plane && plane < v1[axis]) || (v1[axis] < plane && plane < v0[axis])) {
+                    const double t = (plane - v0[axis]) / (v1[axis] - v0[axis]);
+                    double p[3];
+                    for (int a = 0; a < 3; ++a) p[a] = v0[a] + t * (v1[a] - v0[a]);
+                    p[axis] = plane;
+                    growPoint(clipped, p);
+                }
+            }
+        }
+    } else {
+        clipped = reference.bounds;
+    }
+
+    // Restreint à la boîte courante de la référence (déjà rognée par les découpes
+    // précédentes) et à la tranche ; un résultat vide (arrondis) retombe sur la boîte
+    for (int a = 0; a < 3; ++a) {
+        const double aLo = a == axis ? std::max(lo, reference.bounds.min[a]) : reference.bounds.min[a];
+        const double aHi = a == axis ? std::min(hi, reference.bounds.max[a]) : reference.bounds.max[a];
+        clipped.min[a] = std::max(clipped.min[a], aLo);
+        clipped.max[a] = std::min(clipped.max[a], aHi);
+        if (clipped.min[a] > clipped.max[a]) {
+            clipped.min[a] = aLo;
+            clipped.max[a] = std::max(aLo, aHi);
+        }
+    }
+    return clipped;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include "BVHNode.h"
+#include "../shapes/Shape.h"
+
+/**
+ * Construction d'un BVH à découpes spatiales (SBVH, Stich et al. 2009).
+ * Chaque nœud compare la meilleure découpe SAH par objets à une découpe par un
+ * plan : les références qui chevauchent le plan sont alors dupliquées des deux
+ * côtés, avec des boîtes rognées sur le triangle réel. Les découpes spatiales ne
+ * sont tentées que si les enfants de la découpe par objets se recouvrent de plus
+ * de spatialSplitAlpha fois l'aire de la racine, et le nombre total de duplications
+ * est borné par duplicationBudget. Une même primitive peut donc figurer dans
+ * plusieurs feuilles. Les formes autres que les triangles sont rognées à leur boîte.
+ */
+class SBVHBuilder {
+public:
+    static std::shared_ptr<BVHNode> build(const std::vector<std::shared_ptr<Shape>>& shapes,
+                                          const BVHBuildOptions& options);
+
+private:
+    struct Bounds {
+        double min[3];
+        double max[3];
+    };
+
+    struct Reference {
+        uint32_t primitive;
+        Bounds bounds;
+    };
+
+    struct Primitive {
+        std::shared_ptr<Shape> shape;
+        bool isTriangle;
+        double vertices[3][3];
+    };
+
+    SBVHBuilder(const std::vector<std::shared_ptr<Shape>>& shapes, const BVHBuildOptions& options);
+
+    std::shared_ptr<BVHNode> buildNode(std::vector<Reference>& references, int depth);
+
+    // Boîte de la référence rognée à la tranche [lo, hi] de l'axe donné
+    Bounds clip(const Reference& reference, int axis, double lo, double hi) const;
+
+    std::vector<Primitive> primitives;
+    BVHBuildOptions options;
+    double rootArea = 0.0;
+    std::atomic<long long> remainingDuplicates{0};
+};
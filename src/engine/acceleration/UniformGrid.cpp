@@ -0,0 +1,315 @@
+#include "UniformGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+}
+
+UniformGrid::UniformGrid(const std::vector<std::shared_ptr<Shape>>& shapes)
+    : shapes(shapes)
+{
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+
+    primitives = partitionShapes(shapes);
+    stats.unboundedCount = unboundedPrimitives.size();
+
+    if (primitives.empty()) {
+        bounds = AABB(Vector3(0, 0, 0), Vector3(0, 0, 0));
+        return;
+    }
+
+    for (const auto& shape : primitives) {
+        bounds.grow(shape->getBoundingBox());
+    }
+    margin = getBoundsMargin(bounds);
+    const Vector3 padding(margin, margin, margin);
+    bounds = AABB(bounds.min - padding, bounds.max + padding);
+
+    // Cellules à peu près cubiques, environ CELLS_PER_PRIMITIVE par primitive
+    const Vector3 extent = bounds.getExtent();
+    const double volume = extent.x() * extent.y() * extent.z();
+    const double cellEdge = std::cbrt(volume / (CELLS_PER_PRIMITIVE * static_cast<double>(primitives.size())));
+    for (int a = 0; a < 3; ++a) {
+        const double cells = std::ceil(extent[a] / cellEdge);
+        resolution[a] = static_cast<int>(std::clamp(cells, 1.0, static_cast<double>(MAX_RESOLUTION)));
+    }
+    cellSize = Vector3(extent.x() / resolution[0], extent.y() / resolution[1], extent.z() / resolution[2]);
+    invCellSize = Vector3(1.0 / cellSize.x(), 1.0 / cellSize.y(), 1.0 / cellSize.z());
+
+    const size_t cellCount = static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2];
+
+    // Deux passages sur les primitives : compte des références de chaque cellule,
+    // puis remplissage des plages obtenues par somme préfixe
+    std::vector<int> cellRanges(6 * primitives.size());
+    cellOffsets.assign(cellCount + 1, 0);
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        int* range = &cellRanges[6 * i];
+        getCellRange(primitives[i]->getBoundingBox(), range);
+        for (int z = range[2]; z <= range[5]; ++z) {
+            for (int y = range[1]; y <= range[4]; ++y) {
+                for (int x = range[0]; x <= range[3]; ++x) {
+                    cellOffsets[(static_cast<size_t>(z) * resolution[1] + y) * resolution[0] + x + 1]++;
+                }
+            }
+        }
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        cellOffsets[c + 1] += cellOffsets[c];
+    }
+
+    cellPrimitives.resize(cellOffsets[cellCount]);
+    std::vector<uint32_t> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        const int* range = &cellRanges[6 * i];
+        for (int z = range[2]; z <= range[5]; ++z) {
+            for (int y = range[1]; y <= range[4]; ++y) {
+                for (int x = range[0]; x <= range[3]; ++x) {
+                    cellPrimitives[cursor[(static_cast<size_t>(z) * resolution[1] + y) * resolution[0] + x]++] =
+                        static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    updateCellStats();
+
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    stats.buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+}
+
+void UniformGrid::getCellRange(const AABB& box, int range[6]) const {
+    for (int a = 0; a < 3; ++a) {
+        range[a] = cellCoordinate(box.min[a] - margin, a);
+        range[3 + a] = cellCoordinate(box.max[a] + margin, a);
+    }
+}
+
+void UniformGrid::updateCellStats() {
+    const size_t cellCount = cellOffsets.empty() ? 0 : cellOffsets.size() - 1;
+    stats.nodeCount = cellCount;
+    stats.leafCount = 0;
+    for (size_t c = 0; c < cellCount; ++c) {
+        if (cellOffsets[c + 1] > cellOffsets[c]) {
+            stats.leafCount++;
+        }
+    }
+    stats.primitiveCount = cellPrimitives.size();
+    stats.unboundedCount = unboundedPrimitives.size();
+    stats.bytes = cellOffsets.size() * sizeof(uint32_t) + cellPrimitives.size() * sizeof(uint32_t);
+}
+
+int UniformGrid::cellCoordinate(const double value, const int axis) const {
+    const int cell = static_cast<int>((value - bounds.min[axis]) * invCellSize[axis]);
+    return std::clamp(cell, 0, resolution[axis] - 1);
+}
+
+template <typename Visitor>
+bool UniformGrid::traverse(const Ray& ray, const double tMax, Visitor&& visit) const {
+    if (cellPrimitives.empty()) {
+        return true;
+    }
+
+    double tEnter, tExit;
+    if (!bounds.intersect(ray, tEnter, tExit)) {
+        return true;
+    }
+    tExit = std::min(tExit, tMax);
+    if (tEnter > tExit) {
+        return true;
+    }
+
+    // Cellule d'entrée, puis distance jusqu'à la prochaine limite de cellule sur
+    // chaque axe et distance entre deux limites successives
+    const Vector3 entry = ray.origin + ray.direction * tEnter;
+    int cell[3], step[3], stop[3];
+    double tNext[3], tDelta[3];
+    for (int a = 0; a < 3; ++a) {
+        cell[a] = cellCoordinate(entry[a], a);
+        if (ray.direction[a] > 0.0) {
+            step[a] = 1;
+            stop[a] = resolution[a];
+            tNext[a] = tEnter + (bounds.min[a] + (cell[a] + 1) * cellSize[a] - entry[a]) * ray.invDirection[a];
+            tDelta[a] = cellSize[a] * ray.invDirection[a];
+        } else if (ray.direction[a] < 0.0) {
+            step[a] = -1;
+            stop[a] = -1;
+            tNext[a] = tEnter + (bounds.min[a] + cell[a] * cellSize[a] - entry[a]) * ray.invDirection[a];
+            tDelta[a] = -cellSize[a] * ray.invDirection[a];
+        } else {
+            step[a] = 0;
+            stop[a] = -1;
+            tNext[a] = INF;
+            tDelta[a] = INF;
+        }
+    }
+
+    double t = tEnter;
+    while (true) {
+        const int axis = tNext[0] < tNext[1]
+            ? (tNext[0] < tNext[2] ? 0 : 2)
+            : (tNext[1] < tNext[2] ? 1 : 2);
+        const double tCellExit = std::min(std::max(tNext[axis], t), tExit);
+
+        const size_t index = (static_cast<size_t>(cell[2]) * resolution[1] + cell[1]) * resolution[0] + cell[0];
+        if (cellOffsets[index + 1] > cellOffsets[index] && !visit(index, t, tCellExit)) {
+            return false;
+        }
+
+        if (tNext[axis] >= tExit) {
+            return true;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] == stop[axis]) {
+            return true;
+        }
+        t = tCellExit;
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+Intersection UniformGrid::getIntersection(const Ray& ray) const {
+    double tMax = ray.tMax;
+    Intersection closest = intersectUnbounded(ray, tMax);
+
+    traverse(ray, tMax, [&](const size_t cell, double, const double tCellExit) {
+        for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+            const Intersection inter = primitives[cellPrimitives[i]]->getIntersection(ray.origin, ray.direction,
+                                                                                      ray.tMin, tMax);
+            if (inter.lambda >= ray.tMin && inter.lambda < tMax) {
+                closest = inter;
+                tMax = inter.lambda;
+            }
+        }
+        // Les cellules suivantes commencent au-delà de tCellExit
+        return tMax > tCellExit;
+    });
+
+    return closest;
+}
+
+bool UniformGrid::occluded(const Ray& ray) const {
+    if (unboundedOccluded(ray)) {
+        return true;
+    }
+
+    return !traverse(ray, ray.tMax, [&](const size_t cell, double, double) {
+        for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+            if (primitives[cellPrimitives[i]]->hasIntersection(ray.origin, ray.direction, ray.tMin, ray.tMax)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool UniformGrid::forEachHit(const Ray& ray, const IntersectionCallback& callback) const {
+    if (!forEachUnboundedHit(ray, callback)) {
+        return false;
+    }
+
+    return traverse(ray, ray.tMax, [&](const size_t cell, const double tCellEnter, const double tCellExit) {
+        for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+            if (!primitives[cellPrimitives[i]]->forEachIntersection(ray.origin, ray.direction,
+                                                                   tCellEnter, tCellExit, callback)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool UniformGrid::update(double) {
+    *this = UniformGrid(shapes);
+    return true;
+}
+
+void UniformGrid::insert(const std::shared_ptr<Shape>& shape) {
+    shapes.push_back(shape);
+    shape->setBoundingBox();
+    if (!shape->isBounded()) {
+        unboundedPrimitives.push_back(shape);
+        stats.unboundedCount = unboundedPrimitives.size();
+        return;
+    }
+
+    // Une forme qui dépasse de la grille (ou une grille vide) impose de la redimensionner
+    const AABB& box = shape->getBoundingBox();
+    if (primitives.empty() || !bounds.contains(box.min) || !bounds.contains(box.max)) {
+        *this = UniformGrid(shapes);
+        return;
+    }
+
+    const uint32_t primitive = static_cast<uint32_t>(primitives.size());
+    primitives.push_back(shape);
+    int range[6];
+    getCellRange(box, range);
+
+    // Les plages des cellules sont recopiées dans l'ordre, la nouvelle référence
+    // ajoutée à la fin de chaque cellule chevauchée
+    std::vector<uint32_t> offsets(cellOffsets.size());
+    std::vector<uint32_t> references;
+    references.reserve(cellPrimitives.size()
+        + static_cast<size_t>(range[3] - range[0] + 1) * (range[4] - range[1] + 1) * (range[5] - range[2] + 1));
+    size_t c = 0;
+    for (int z = 0; z < resolution[2]; ++z) {
+        for (int y = 0; y < resolution[1]; ++y) {
+            for (int x = 0; x < resolution[0]; ++x, ++c) {
+                references.insert(references.end(), cellPrimitives.begin() + cellOffsets[c],
+                                  cellPrimitives.begin() + cellOffsets[c + 1]);
+                if (x >= range[0] && x <= range[3] && y >= range[1] && y <= range[4]
+                    && z >= range[2] && z <= range[5]) {
+                    references.push_back(primitive);
+                }
+                offsets[c + 1] = static_cast<uint32_t>(references.size());
+            }
+        }
+    }
+    cellOffsets = std::move(offsets);
+    cellPrimitives = std::move(references);
+
+    updateCellStats();
+}
+
+bool UniformGrid::remove(const std::shared_ptr<Shape>& shape) {
+    const auto it = std::find(shapes.begin(), shapes.end(), shape);
+    if (it == shapes.end()) {
+        return false;
+    }
+    shapes.erase(it);
+
+    const auto unbounded = std::find(unboundedPrimitives.begin(), unboundedPrimitives.end(), shape);
+    if (unbounded != unboundedPrimitives.end()) {
+        unboundedPrimitives.erase(unbounded);
+        stats.unboundedCount = unboundedPrimitives.size();
+        return true;
+    }
+
+    const auto found = std::find(primitives.begin(), primitives.end(), shape);
+    const uint32_t primitive = static_cast<uint32_t>(found - primitives.begin());
+    primitives.erase(found);
+
+    // Compactage en place : les références à la forme disparaissent et les indices
+    // des primitives suivantes reculent d'un cran
+    const size_t cellCount = cellOffsets.size() - 1;
+    uint32_t write = 0;
+    uint32_t begin = cellOffsets[0];
+    for (size_t c = 0; c < cellCount; ++c) {
+        const uint32_t end = cellOffsets[c + 1];
+        cellOffsets[c] = write;
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t reference = cellPrimitives[i];
+            if (reference != primitive) {
+                cellPrimitives[write++] = reference > primitive ? reference - 1 : reference;
+            }
+        }
+        begin = end;
+    }
+    cellOffsets[cellCount] = write;
+    cellPrimitives.resize(write);
+
+    updateCellStats();
+    return true;
+}
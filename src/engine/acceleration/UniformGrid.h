@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Accelerator.h"
+
+/**
+ * Grille uniforme : la boîte de la scène est découpée en cellules de même taille,
+ * chacune référençant les primitives dont la boîte la chevauche. Un rayon visite
+ * les cellules qu'il traverse dans l'ordre (3D-DDA, Amanatides et Woo 1987) et
+ * s'arrête dès que l'intersection la plus proche tombe dans la cellule courante.
+ * Adaptée aux scènes de primitives de tailles voisines réparties uniformément,
+ * où elle évite la descente d'un arbre ; une primitive qui couvre plusieurs
+ * cellules est référencée, et testée, dans chacune.
+ *
+ * Les références sont rangées par cellule dans un seul tableau (cellOffsets donne
+ * la plage de chaque cellule), sans allocation par cellule.
+ */
+class UniformGrid : public Accelerator {
+public:
+    // Cellules par primitive visées pour le choix de la résolution
+    static constexpr double CELLS_PER_PRIMITIVE = 2.0;
+
+    // Résolution maximale par axe
+    static constexpr int MAX_RESOLUTION = 256;
+
+    explicit UniformGrid(const std::vector<std::shared_ptr<Shape>>& shapes);
+
+    AcceleratorType getType() const override { return AcceleratorType::Grid; }
+    const char* getName() const override { return "Uniform grid"; }
+
+    Intersection getIntersection(const Ray& ray) const override;
+    bool occluded(const Ray& ray) const override;
+    bool forEachHit(const Ray& ray, const IntersectionCallback& callback) const override;
+
+    // La grille n'a pas de refit : elle est toujours reconstruite
+    bool update(double rebuildThreshold) override;
+
+    // Une forme contenue dans la boîte de la grille est ajoutée aux cellules qu'elle
+    // chevauche, sans changer la résolution ; sinon la grille est reconstruite
+    void insert(const std::shared_ptr<Shape>& shape) override;
+    bool remove(const std::shared_ptr<Shape>& shape) override;
+
+    // Les cellules modifiées restent aussi efficaces qu'après une construction
+    bool needsRebuild(double) const override { return false; }
+
+    AABB getBounds() const override { return bounds; }
+    const AcceleratorStats& getStats() const override { return stats; }
+    const int* getResolution() const { return resolution; }
+
+private:
+    // Indice de la cellule contenant la coordonnée value sur l'axe axis
+    int cellCoordinate(double value, int axis) const;
+
+    // Plage de cellules [range[0..2], range[3..5]] chevauchée par box
+    void getCellRange(const AABB& box, int range[6]) const;
+
+    // Statistiques des cellules après une construction, une insertion ou un retrait
+    void updateCellStats();
+
+    // Visite dans l'ordre les cellules non vides traversées par le rayon entre ray.tMin
+    // et tMax : visit(cell, tEnter, tExit) renvoie false pour arrêter le parcours.
+    // Renvoie false si visit a arrêté le parcours
+    template <typename Visitor>
+    bool traverse(const Ray& ray, double tMax, Visitor&& visit) const;
+
+    std::vector<std::shared_ptr<Shape>> shapes; ///< Formes d'origine, pour la reconstruction
+    std::vector<std::shared_ptr<Shape>> primitives;
+    std::vector<uint32_t> cellOffsets;    ///< Cellule c : références [cellOffsets[c], cellOffsets[c + 1][
+    std::vector<uint32_t> cellPrimitives; ///< Indices dans primitives
+    AABB bounds;
+    double margin = 0.0; ///< Marge ajoutée aux boîtes des primitives
+    int resolution[3] = {0, 0, 0};
+    Vector3 cellSize;
+    Vector3 invCellSize;
+    AcceleratorStats stats;
+};
@@ -1,7 +1,31 @@
 #include "Scene.h"
+#include <algorithm>
+#include <utility>
 
 void Scene::addShape(const std::shared_ptr<Shape>& shape) {
     shapes.push_back(shape);
+    shapeChanges.added.push_back(shape);
+}
+
+bool Scene::removeShape(const std::shared_ptr<Shape>& shape) {
+    const auto it = std::find(shapes.begin(), shapes.end(), shape);
+    if (it == shapes.end()) {
+        return false;
+    }
+    shapes.erase(it);
+
+    auto& added = shapeChanges.added;
+    const auto pending = std::find(added.begin(), added.end(), shape);
+    if (pending != added.end()) {
+        added.erase(pending);
+    } else {
+        shapeChanges.removed.push_back(shape);
+    }
+    return true;
+}
+
+Scene::ShapeChanges Scene::takeShapeChanges() {
+    return std::exchange(shapeChanges, ShapeChanges());
 }
 
 void Scene::addLightSource(const std::shared_ptr<LightSource>& lightSource) {
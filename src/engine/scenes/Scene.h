@@ -11,8 +11,18 @@
 // class LightSource;
 
 class Scene {
+public:
+    // Formes ajoutées et retirées depuis la dernière lecture par takeShapeChanges
+    struct ShapeChanges {
+        std::vector<std::shared_ptr<Shape>> added;
+        std::vector<std::shared_ptr<Shape>> removed;
+
+        bool empty() const { return added.empty() && removed.empty(); }
+    };
+
 protected:
     std::vector<std::shared_ptr<Shape>> shapes;
+    ShapeChanges shapeChanges;
     std::vector<std::shared_ptr<LightSource>> lightSources;
 
     Vector3 ambient = {0.2, 0.2, 0.2};
@@ -62,12 +72,17 @@ public:
     virtual void createLights() = 0;
 
     void addShape(const std::shared_ptr<Shape>& shape);
+    // Renvoie false si la forme n'appartient pas à la scène
+    bool removeShape(const std::shared_ptr<Shape>& shape);
     void addLightSource(const std::shared_ptr<LightSource>& lightSource);
 
     void setSkyColor(const Vector3& color);
     void setAmbient(const Vector3& ambient);
 
-    std::vector<std::shared_ptr<Shape>> getShapes() const { return shapes; }
+    const std::vector<std::shared_ptr<Shape>>& getShapes() const { return shapes; }
+    // Renvoie les ajouts et retraits de formes en attente et les oublie : une forme
+    // ajoutée puis retirée entre deux appels n'apparaît dans aucune des deux listes
+    ShapeChanges takeShapeChanges();
     std::vector<std::shared_ptr<LightSource>> getLightSources() const { return lightSources; }
     const Vector3& getSkyColor() const { return skyColor; }
     const Vector3& getAmbient() const { return ambient; }
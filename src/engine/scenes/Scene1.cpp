@@ -58,7 +58,6 @@ void Scene1::createShapes()
     // auto teapot = std::make_shared<OBJ>("res/obj/teapot.obj", Vector3(0, 0, -5));
     // teapot->setColor(Scene::ORANGE);
     // teapot->setMaterial(Material(0.0, 0.3, 1000, Scene::ETA_AIR));
-    // teapot->update();
     // addShape(teapot);
 }
 
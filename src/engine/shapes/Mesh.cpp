@@ -0,0 +1,356 @@
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "ObjParser.h"
+#include "Triangle.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    constexpr char CACHE_MAGIC[8] = {'R', 'T', 'M', 'E', 'S', 'H', 'B', 'V'};
+
+    /// Sidecar layout: header, float[3 * vertexCount] positions, float[2 * uvCount] texture
+    /// coordinates, uint32_t[3 * triangleCount] vertex indices, uint32_t[uvIndexCount]
+    /// texture indices (0 or 3 * triangleCount), LinearBVHNode[nodeCount], then
+    /// uint32_t[primitiveCount] giving the triangle behind each BVH primitive
+    /// (a spatial-split BVH references some triangles several times)
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t nodeSize;
+        uint64_t sourceHash;
+        uint64_t optionsHash;
+        uint64_t vertexCount;
+        uint64_t uvCount;
+        uint64_t triangleCount;
+        uint64_t uvIndexCount;
+        uint64_t nodeCount;
+        uint64_t primitiveCount;
+    };
+
+    // Copies count elements from cursor into values and advances cursor
+    template <typename T>
+    void readArray(const char*& cursor, std::vector<T>& values, const size_t count) {
+        values.resize(count);
+        std::memcpy(values.data(), cursor, count * sizeof(T));
+        cursor += count * sizeof(T);
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& out, const std::vector<T>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // True if every index is below count
+    bool indicesBelow(const std::vector<uint32_t>& indices, const size_t count) {
+        return std::all_of(indices.begin(), indices.end(), [count](const uint32_t index) { return index < count; });
+    }
+
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    uint64_t hashBytes(const void* data, const size_t size, uint64_t hash = FNV_OFFSET) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // The layout only changes how the binary tree is collapsed after loading,
+    // so it does not take part in the key
+    uint64_t hashOptions(const BVHBuildOptions& options) {
+        const int splitMethod = static_cast<int>(options.splitMethod);
+        uint64_t hash = hashBytes(&splitMethod, sizeof(splitMethod));
+        hash = hashBytes(&options.binCount, sizeof(options.binCount), hash);
+        hash = hashBytes(&options.traversalCost, sizeof(options.traversalCost), hash);
+        hash = hashBytes(&options.leafCost, sizeof(options.leafCost), hash);
+        hash = hashBytes(&options.spatialSplitAlpha, sizeof(options.spatialSplitAlpha), hash);
+        hash = hashBytes(&options.duplicationBudget, sizeof(options.duplicationBudget), hash);
+        hash = hashBytes(&options.maxLeafSize, sizeof(options.maxLeafSize), hash);
+        const int nodeOrder = static_cast<int>(options.nodeOrder);
+        return hashBytes(&nodeOrder, sizeof(nodeOrder), hash);
+    }
+
+    // Checks that every child and primitive range stays inside the arrays
+    bool isValidTree(const std::vector<LinearBVHNode>& nodes, const std::vector<uint32_t>& primitiveIndices,
+                     const size_t triangleCount) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const LinearBVHNode& node = nodes[i];
+            if (node.primitiveCount > 0) {
+                if (static_cast<size_t>(node.primitivesOffset) + node.primitiveCount > primitiveIndices.size()) return false;
+            } else if (node.secondChildOffset <= i + 1 || node.secondChildOffset >= nodes.size()) {
+                return false;
+            }
+        }
+        return indicesBelow(primitiveIndices, triangleCount);
+    }
+}
+
+Mesh::Mesh(const std::string& objFileName, const BVHBuildOptions& bvhOptions, const bool useDiskCache)
+    : bvhOptions(bvhOptions) {
+    // Une seule projection du fichier sert à l'empreinte du cache et à l'analyse
+    const MappedFile source(objFileName);
+    uint64_t sourceHash = 0;
+    std::string cachePath;
+    if (useDiskCache) {
+        sourceHash = hashBytes(source.data(), source.size());
+        cachePath = getCachePath(objFileName);
+        if (loadDiskCache(cachePath, sourceHash)) {
+            return;
+        }
+    }
+
+    ObjData data = ObjParser::parse(source, objFileName);
+    positions = std::move(data.positions);
+    uvs = std::move(data.uvs);
+    vertexIndices = std::move(data.vertexIndices);
+    uvIndices = std::move(data.uvIndices);
+    computeToleranceScales();
+    buildBVH();
+
+    if (useDiskCache) {
+        saveDiskCache(cachePath, sourceHash);
+    }
+}
+
+void Mesh::computeToleranceScales() {
+    vertexScale = 0.0;
+    edgeScale = 0.0;
+    for (uint32_t i = 0; i < getTriangleCount(); ++i) {
+        Triangle::growToleranceScales(getVertex(i, 0), getVertex(i, 1), getVertex(i, 2), vertexScale, edgeScale);
+    }
+}
+
+void Mesh::buildBVH() {
+    // Les constructeurs (SAH, LBVH, SBVH) travaillent sur des formes : l'arbre est
+    // construit sur des Triangle temporaires, puis ses primitives sont remplacées
+    // par leurs indices. Le repli ou la compression se fait sur l'arbre indexé
+    const std::vector<std::shared_ptr<Shape>> shapes = createTriangleShapes();
+    BVHBuildOptions binaryOptions = bvhOptions;
+    binaryOptions.layout = BVHLayout::Binary;
+    const BVH built(shapes, binaryOptions);
+
+    std::unordered_map<const Shape*, uint32_t> triangleIndex;
+    triangleIndex.reserve(shapes.size());
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        triangleIndex[shapes[i].get()] = static_cast<uint32_t>(i);
+    }
+    std::vector<uint32_t> primitiveIndices;
+    primitiveIndices.reserve(built.getPrimitives().size());
+    for (const auto& primitive : built.getPrimitives()) {
+        primitiveIndices.push_back(triangleIndex.at(primitive.get()));
+    }
+
+    bvh = std::make_unique<BVH>(built.getNodes(), std::move(primitiveIndices), *this, bvhOptions);
+}
+
+AABB Mesh::getTriangleBounds(const uint32_t triangle) const {
+    const Vector3 A = getVertex(triangle, 0);
+    const Vector3 B = getVertex(triangle, 1);
+    const Vector3 C = getVertex(triangle, 2);
+    return AABB(A.min(B).min(C), A.max(B).max(C));
+}
+
+Intersection Mesh::getTriangleIntersection(const uint32_t triangle, const Vector3& P, const Vector3& v,
+                                           const double tMin, const double tMax) const {
+    double lambda;
+    double sums[3];
+    Vector3 normal;
+    if (!Triangle::intersect(getVertex(triangle, 0), getVertex(triangle, 1), getVertex(triangle, 2),
+                             vertexScale, edgeScale, P, v, tMin, tMax, lambda, sums, &normal)) {
+        return Intersection();
+    }
+
+    // Chaque test d'arête est proportionnel au poids du sommet opposé
+    const double inverseSum = 1.0 / (sums[0] + sums[1] + sums[2]);
+    return Intersection(lambda, normal, nullptr, triangle, Vector2(sums[1] * inverseSum, sums[2] * inverseSum));
+}
+
+bool Mesh::hasTriangleIntersection(const uint32_t triangle, const Vector3& P, const Vector3& v,
+                                   const double tMin, const double tMax) const {
+    double lambda;
+    return Triangle::intersect(getVertex(triangle, 0), getVertex(triangle, 1), getVertex(triangle, 2),
+                               vertexScale, edgeScale, P, v, tMin, tMax, lambda);
+}
+
+Vector2 Mesh::getTextureCoordinates(const uint32_t triangle, const Vector2& barycentric) const {
+    if (uvIndices.empty()) {
+        return Vector2(0, 0);
+    }
+
+    const double weights[3] = {1.0 - barycentric[0] - barycentric[1], barycentric[0], barycentric[1]};
+    Vector2 uv(0, 0);
+    for (int k = 0; k < 3; ++k) {
+        const float* t = &uvs[2 * static_cast<size_t>(uvIndices[3 * static_cast<size_t>(triangle) + k])];
+        uv = uv + Vector2(t[0], t[1]) * weights[k];
+    }
+    return uv;
+}
+
+double Mesh::getDistanceNearestEdge(const uint32_t triangle, const Vector3& P) const {
+    return Triangle::distanceToEdges(getVertex(triangle, 0), getVertex(triangle, 1), getVertex(triangle, 2), P);
+}
+
+std::vector<std::shared_ptr<Shape>> Mesh::createTriangleShapes() const {
+    std::vector<std::shared_ptr<Shape>> triangles;
+    triangles.reserve(getTriangleCount());
+    for (uint32_t i = 0; i < getTriangleCount(); ++i) {
+        auto triangle = std::make_shared<Triangle>(getVertex(i, 0), getVertex(i, 1), getVertex(i, 2));
+        if (!uvIndices.empty()) {
+            Vector3 corners[3];
+            for (int k = 0; k < 3; ++k) {
+                const float* t = &uvs[2 * static_cast<size_t>(uvIndices[3 * static_cast<size_t>(i) + k])];
+                corners[k] = Vector3(t[0], t[1], 0);
+            }
+            triangle->setTextureCoordinates(corners[0], corners[1], corners[2]);
+        }
+        triangles.push_back(triangle);
+    }
+    return triangles;
+}
+
+std::string Mesh::getCachePath(const std::string& objFileName) {
+    return objFileName + ".bvhcache";
+}
+
+bool Mesh::loadDiskCache(const std::string& cachePath, const uint64_t sourceHash) {
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(cachePath);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    CacheHeader header{};
+    if (file->size() < sizeof(header)) return false;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != DISK_CACHE_VERSION
+        || header.nodeSize != sizeof(LinearBVHNode)
+        || header.sourceHash != sourceHash
+        || header.optionsHash != hashOptions(bvhOptions)) {
+        return false;
+    }
+
+    // Counts are bounded by the file size before computing the expected size
+    const size_t payload = file->size() - sizeof(header);
+    if (header.vertexCount > payload / (3 * sizeof(float)) || header.uvCount > payload / (2 * sizeof(float))
+        || header.triangleCount > payload / (3 * sizeof(uint32_t)) || header.uvIndexCount > payload / sizeof(uint32_t)
+        || header.nodeCount > payload / sizeof(LinearBVHNode) || header.primitiveCount > payload / sizeof(uint32_t)) {
+        return false;
+    }
+    const size_t vertexCount = static_cast<size_t>(header.vertexCount);
+    const size_t uvCount = static_cast<size_t>(header.uvCount);
+    const size_t triangleCount = static_cast<size_t>(header.triangleCount);
+    const size_t uvIndexCount = static_cast<size_t>(header.uvIndexCount);
+    const size_t nodeCount = static_cast<size_t>(header.nodeCount);
+    const size_t primitiveCount = static_cast<size_t>(header.primitiveCount);
+    if ((uvIndexCount != 0 && uvIndexCount != 3 * triangleCount)
+        || payload != (3 * vertexCount + 2 * uvCount) * sizeof(float)
+            + (3 * triangleCount + uvIndexCount) * sizeof(uint32_t)
+            + nodeCount * sizeof(LinearBVHNode) + primitiveCount * sizeof(uint32_t)) {
+        return false;
+    }
+
+    const char* cursor = file->data() + sizeof(header);
+    readArray(cursor, positions, 3 * vertexCount);
+    readArray(cursor, uvs, 2 * uvCount);
+    readArray(cursor, vertexIndices, 3 * triangleCount);
+    readArray(cursor, uvIndices, uvIndexCount);
+    std::vector<LinearBVHNode> nodes;
+    readArray(cursor, nodes, nodeCount);
+    std::vector<uint32_t> primitiveIndices;
+    readArray(cursor, primitiveIndices, primitiveCount);
+
+    if (!indicesBelow(vertexIndices, vertexCount) || !indicesBelow(uvIndices, uvCount)
+        || !isValidTree(nodes, primitiveIndices, triangleCount)) {
+        positions.clear();
+        uvs.clear();
+        vertexIndices.clear();
+        uvIndices.clear();
+        return false;
+    }
+
+    computeToleranceScales();
+    bvh = std::make_unique<BVH>(std::move(nodes), std::move(primitiveIndices), *this, bvhOptions);
+    loadedFromDiskCache = true;
+    return true;
+}
+
+void Mesh::saveDiskCache(const std::string& cachePath, const uint64_t sourceHash) const {
+    const std::vector<LinearBVHNode>& nodes = bvh->getNodes();
+    const std::vector<uint32_t>& primitiveIndices = bvh->getTriangleIndices();
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = DISK_CACHE_VERSION;
+    header.nodeSize = sizeof(LinearBVHNode);
+    header.sourceHash = sourceHash;
+    header.optionsHash = hashOptions(bvhOptions);
+    header.vertexCount = getVertexCount();
+    header.uvCount = uvs.size() / 2;
+    header.triangleCount = getTriangleCount();
+    header.uvIndexCount = uvIndices.size();
+    header.nodeCount = nodes.size();
+    header.primitiveCount = primitiveIndices.size();
+
+    // Written under a temporary name so a concurrent load never maps a partial file;
+    // the name carries the options so two builds of the same OBJ never share it
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp", static_cast<unsigned long long>(header.optionsHash));
+    const std::string tempPath = cachePath + suffix;
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, positions);
+        writeArray(out, uvs);
+        writeArray(out, vertexIndices);
+        writeArray(out, uvIndices);
+        writeArray(out, nodes);
+        writeArray(out, primitiveIndices);
+        if (!out) {
+            out.close();
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+    std::remove(cachePath.c_str());
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+    }
+}
+
+std::shared_ptr<const Mesh> Mesh::load(const std::string& objFileName, const BVHBuildOptions& bvhOptions) {
+    static std::mutex cacheMutex;
+    static std::unordered_map<std::string, std::weak_ptr<const Mesh>> cache;
+
+    // Un même fichier construit avec d'autres paramètres donne un autre BVH : la clé
+    // reprend l'empreinte des options du cache disque, plus la disposition
+    const std::string key = objFileName
+        + '|' + std::to_string(hashOptions(bvhOptions))
+        + '|' + std::to_string(static_cast<int>(bvhOptions.layout));
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (std::shared_ptr<const Mesh> mesh = cache[key].lock()) {
+        return mesh;
+    }
+
+    auto mesh = std::make_shared<const Mesh>(objFileName, bvhOptions);
+    cache[key] = mesh;
+    return mesh;
+}
+
+size_t Mesh::getMemoryBytes() const {
+    return positions.size() * sizeof(float) + uvs.size() * sizeof(float)
+        + (vertexIndices.size() + uvIndices.size()) * sizeof(uint32_t)
+        + bvh->getStats().bytes
+        + bvh->getStats().primitiveCount * sizeof(uint32_t);
+}
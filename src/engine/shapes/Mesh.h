@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <string>
+#include "Shape.h"
+#include "Intersection.h"
+#include "acceleration/AABB.h"
+#include "acceleration/BVH.h"
+
+/**
+ * @brief Triangle mesh loaded from an OBJ file, in object space, with its own BVH.
+ * A mesh is immutable once built and is shared by every OBJ instance that
+ * places it in the scene (bottom level of the two-level acceleration structure).
+ *
+ * Triangles are stored indexed: shared vertex and texture coordinate arrays, in
+ * single precision as read from the file, and three indices per triangle into each.
+ * The BVH references triangles by index and intersects them through this mesh, so
+ * a triangle costs its indices rather than a Triangle shape; the appearance is
+ * carried once by each instance.
+ *
+ * The indexed arrays and the built BVH are saved to a single binary sidecar file
+ * next to the OBJ (see getCachePath). Later loads map that file and skip both
+ * parsing and building, as long as the OBJ contents, the build options and the
+ * cache format version still match; otherwise the mesh is rebuilt and overwrites
+ * the sidecar, so the last options used win.
+ */
+class Mesh {
+public:
+    /// Bumped whenever the sidecar layout or the BVH node layout changes
+    static constexpr uint32_t DISK_CACHE_VERSION = 3;
+
+    Mesh(const std::string& objFileName, const BVHBuildOptions& bvhOptions = {}, bool useDiskCache = true);
+
+    // The BVH keeps a pointer to its mesh
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    /**
+     * @brief Returns the mesh for this file and build options, loading it only
+     * the first time: instances of the same file share one mesh and one BVH
+     */
+    static std::shared_ptr<const Mesh> load(const std::string& objFileName, const BVHBuildOptions& bvhOptions = {});
+
+    const BVH& getBVH() const { return *bvh; }
+    size_t getTriangleCount() const { return vertexIndices.size() / 3; }
+    size_t getVertexCount() const { return positions.size() / 3; }
+    const BVHBuildOptions& getBVHOptions() const { return bvhOptions; }
+
+    /// Object-space vertex of the triangle, corner 0, 1 or 2
+    Vector3 getVertex(uint32_t triangle, int corner) const {
+        const float* p = &positions[3 * static_cast<size_t>(vertexIndices[3 * static_cast<size_t>(triangle) + corner])];
+        return Vector3(p[0], p[1], p[2]);
+    }
+
+    /// Object-space bounding box of the triangle
+    AABB getTriangleBounds(uint32_t triangle) const;
+
+    /**
+     * @brief Hit of the ray (P, v) with the triangle at a distance in [tMin, tMax[, with
+     * the same watertight test as Triangle, its rounding tolerance bounded over the whole
+     * mesh; the hit has no shape and records the triangle index
+     */
+    Intersection getTriangleIntersection(uint32_t triangle, const Vector3& P, const Vector3& v,
+                                         double tMin, double tMax) const;
+    bool hasTriangleIntersection(uint32_t triangle, const Vector3& P, const Vector3& v,
+                                 double tMin, double tMax) const;
+
+    /// Texture coordinates at the barycentric coordinates of a hit, (0, 0) without texture coordinates
+    Vector2 getTextureCoordinates(uint32_t triangle, const Vector2& barycentric) const;
+
+    /// Distance from the object-space point P to the nearest edge of the triangle
+    double getDistanceNearestEdge(uint32_t triangle, const Vector3& P) const;
+
+    /**
+     * @brief Standalone Triangle shapes for every triangle, in index order: used to
+     * build the BVH, and by benchmarks comparing builders and accelerators
+     */
+    std::vector<std::shared_ptr<Shape>> createTriangleShapes() const;
+
+    /// Approximate memory held by the indexed arrays and the BVH
+    size_t getMemoryBytes() const;
+
+    /// True if this mesh was restored from its sidecar file instead of parsed and built
+    bool isLoadedFromDiskCache() const { return loadedFromDiskCache; }
+
+    /// Sidecar file holding the cached triangles and BVH of this file, for the options stored in its header
+    static std::string getCachePath(const std::string& objFileName);
+
+private:
+    void computeToleranceScales();
+    void buildBVH();
+
+    // Restore from the sidecar, false if it is missing, stale or corrupt
+    bool loadDiskCache(const std::string& cachePath, uint64_t sourceHash);
+    // Best effort: a read-only resource directory simply leaves the mesh uncached
+    void saveDiskCache(const std::string& cachePath, uint64_t sourceHash) const;
+
+    std::vector<float> positions;         ///< x, y, z of each vertex
+    std::vector<float> uvs;               ///< u, v of each texture vertex, v flipped
+    std::vector<uint32_t> vertexIndices;  ///< Three vertex indices per triangle
+    std::vector<uint32_t> uvIndices;      ///< Three texture vertex indices per triangle, empty without texture coordinates
+    double vertexScale = 0.0;             ///< Largest squared vertex coordinate, for the edge test tolerance
+    double edgeScale = 0.0;               ///< Largest edge L1 norm, for the edge test tolerance
+    std::unique_ptr<BVH> bvh;
+    BVHBuildOptions bvhOptions;
+    bool loadedFromDiskCache = false;
+};
@@ -1,191 +1,96 @@
 #include "OBJ.h"
+#include "Triangle.h"
 #include "scenes/Scene.h"
 
-#include <fstream>
-#include <sstream>
+#include <limits>
 #include <stdexcept>
 
-OBJ::OBJ(const std::string& objFileName, const Vector3& position) : bvh(nullptr) {
-    triangles = {};
-    std::vector<Vector3> textures;
-    std::vector<Vector3> vertexList;
-    std::vector<Vector3> normalList;
+OBJ::OBJ(const std::string& objFileName, const Vector3& position, const BVHBuildOptions& bvhOptions)
+    : OBJ(Mesh::load(objFileName, bvhOptions), Transform::translate(position)) {}
 
-    std::ifstream file(objFileName);
-    if (!file.is_open()) {
-        throw std::runtime_error("File not found: " + objFileName);
-    }
-
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string prefix;
-        iss >> prefix;
-
-        if (prefix == "v") {
-            float x, y, z;
-            iss >> x >> y >> z;
-            vertexList.push_back(position + Vector3(x, y, z));
-
-        } else if (prefix == "vn") {
-            float x, y, z;
-            iss >> x >> y >> z;
-            normalList.emplace_back(x, y, z);
-
-        } else if (prefix == "vt") {
-            float u, v;
-            iss >> u >> v;
-            textures.emplace_back(u, 1.0f - v, 0.0f); // Inversion verticale
-
-        } else if (prefix == "f") {
-            std::vector<Vector3> faceVertices;
-            std::vector<Vector3> faceUVs;
-            std::string token;
-            while (iss >> token) {
-                std::istringstream tokenStream(token);
-                std::string part;
-                std::vector<std::string> parts;
-                while (std::getline(tokenStream, part, '/')) {
-                    parts.push_back(part);
-                }
-
-                int vertexIndex = std::stoi(parts[0]) - 1;
-                faceVertices.push_back(vertexList[vertexIndex]);
-
-                if (parts.size() > 1 && !parts[1].empty()) {
-                    int textureIndex = std::stoi(parts[1]) - 1;
-                    faceUVs.push_back(textures[textureIndex]);
-                } else {
-                    faceUVs.emplace_back(0, 0, 0);
-                }
-            }
-
-            for (size_t i = 2; i < faceVertices.size(); ++i) {
-                Vector3 A = faceVertices[0];
-                Vector3 B = faceVertices[i - 1];
-                Vector3 C = faceVertices[i];
-
-                Vector3 uvA = faceUVs[0];
-                Vector3 uvB = faceUVs[i - 1];
-                Vector3 uvC = faceUVs[i];
-
-                Triangle triangle(A, B, C);
-                triangle.setTextureCoordinates(uvA, uvB, uvC);
-
-                triangles.push_back(triangle);
-            }
-        }
-    }
+OBJ::OBJ(std::shared_ptr<const Mesh> mesh, const Transform& transform)
+    : mesh(std::move(mesh)), transform(transform) {
+    OBJ::setBoundingBox();
+}
 
-    this->rebuildBVH();
-    this->update();
+Intersection OBJ::toWorld(const Intersection& local) const {
+    return Intersection(local.lambda, transform.applyToNormal(local.normal).normalized(), this, local.primitiveIndex,
+                        local.barycentric);
 }
 
 Intersection OBJ::getIntersection(const Vector3& P, const Vector3& v) const {
+    return getIntersection(P, v, Scene::EPSILON, std::numeric_limits<double>::infinity());
+}
+
+// La direction n'est pas renormalisée dans l'espace objet : lambda reste
+// donc le même paramètre le long du rayon dans les deux espaces, et
+// l'intervalle [tMin, tMax[ passe tel quel au BVH du maillage
+Intersection OBJ::getIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
     if (!visible) return Intersection();
 
-    const Intersection boxHit = bvh->getIntersection(P, v);
-    if (boxHit.lambda < Scene::EPSILON) {
+    const Intersection hit = mesh->getBVH().getIntersection(transform.applyInverseToPoint(P),
+                                                            transform.applyInverseToVector(v), tMin, tMax);
+    if (hit.lambda < Scene::EPSILON) {
         return Intersection(); // No intersection
     }
 
-    return boxHit;
+    return toWorld(hit);
 }
 
-// void OBJ::scale(double scaleFactor) {
-//     Vector3 center = calculateCenter();
-//
-//     for (auto& triangle : triangles) {
-//         triangle.A = center + (triangle.A - center) * scaleFactor;
-//         triangle.B = center + (triangle.B - center) * scaleFactor;
-//         triangle.C = center + (triangle.C - center) * scaleFactor;
-//
-//         triangle.normal = (triangle.B - triangle.A).cross(triangle.C - triangle.A).normalize();
-//         triangle.distance = -triangle.normal.dot(triangle.A);
-//
-//         triangle.setBoundingBox();
-//     }
-//
-//     delete bvh;
-//     bvh = new BVHNode(triangles);
-// }
-//
-// void OBJ::rotate(double angle, const Vector3& axis) {
-//     Vector3 center = calculateCenter();
-//
-//     for (auto& triangle : triangles) {
-//         triangle.A = center + (triangle.A - center).rotate(angle, axis);
-//         triangle.B = center + (triangle.B - center).rotate(angle, axis);
-//         triangle.C = center + (triangle.C - center).rotate(angle, axis);
-//
-//         triangle.normal = (triangle.B - triangle.A).cross(triangle.C - triangle.A).normalize();
-//         triangle.distance = -triangle.normal.dot(triangle.A);
-//
-//         triangle.setBoundingBox();
-//     }
-//
-//     delete bvh;
-//     bvh = new BVHNode(triangles);
-// }
-
-Vector3 OBJ::calculateCenter() const
-{
-    Vector3 center(0, 0, 0);
-    for (const auto& triangle : triangles) {
-        for (const Vector3& vertex : triangle.getVertices())
-        {
-            center += vertex;
-        }
-    }
-    return center * (1.0 / (triangles.size() * 3));
+bool OBJ::hasIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    if (!visible) return false;
+
+    return mesh->getBVH().occluded(transform.applyInverseToPoint(P), transform.applyInverseToVector(v), tMin, tMax);
 }
 
-void OBJ::setBoundingBox() {
-    Vector3 min(-std::numeric_limits<double>::max(),
-                -std::numeric_limits<double>::max(),
-                -std::numeric_limits<double>::max());
-
-    Vector3 max(std::numeric_limits<double>::max(),
-                std::numeric_limits<double>::max(),
-                std::numeric_limits<double>::max());
-
-    for (auto& triangle : triangles) {
-        triangle.setBoundingBox();
-        BoundingBox bb = *triangle.getBoundingBox();
-        min = min.min(bb.getMin());
-        max = max.max(bb.getMax());
-    }
+bool OBJ::forEachIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax,
+                              const IntersectionCallback& callback) const {
+    if (!visible) return true;
 
-    this->boundingBox = std::make_unique<BoundingBox>(min, max);
+    return mesh->getBVH().forEachHit(transform.applyInverseToPoint(P), transform.applyInverseToVector(v),
+                                     tMin, tMax, [&](const Intersection& hit) {
+                                         return callback(toWorld(hit));
+                                     });
+}
 
-    this->rebuildBVH();
+void OBJ::setTransform(const Transform& newTransform) {
+    transform = newTransform;
+    setBoundingBox();
+    markBoundsDirty();
 }
 
-void OBJ::update() {
-    for (auto& triangle : triangles) {
-        triangle.setColor(this->getColor());
-        triangle.getMaterial().setShininess(this->getMaterial().getShininess());
-        triangle.getMaterial().setEta(this->getMaterial().getEta());
-        triangle.getMaterial().setReflectivity(this->getMaterial().getReflectivity());
-        triangle.getMaterial().setTransparency(this->getMaterial().getTransparency());
-        // triangle.getMaterial().setTexture(texture);
+void OBJ::setBoundingBox() {
+    // Boîte monde : les 8 coins de la boîte objet transformés
+    const AABB local = mesh->getBVH().getBounds();
+    const Vector3 corners[2] = {local.min, local.max};
+
+    AABB world;
+    for (int i = 0; i < 8; ++i) {
+        const Vector3 corner(corners[i & 1].x(), corners[(i >> 1) & 1].y(), corners[(i >> 2) & 1].z());
+        world.grow(transform.applyToPoint(corner));
     }
+
+    this->boundingBox = world;
 }
 
 double OBJ::getDistanceNearestEdge(const Vector3& P, const Camera& camera) const
 {
-    throw std::runtime_error("getDistanceNearestEdge should be handled by inner Triangle");
+    throw std::runtime_error("getDistanceNearestEdge should be handled by the hit triangle");
+}
+
+double OBJ::getHitDistanceNearestEdge(const Intersection& hit, const Vector3& P, const Camera& camera) const
+{
+    // L'épaisseur du fil de fer est une distance monde : les sommets sont ramenés dans
+    // l'espace monde plutôt que P dans l'espace objet, qu'une mise à l'échelle déformerait
+    return Triangle::distanceToEdges(transform.applyToPoint(mesh->getVertex(hit.primitiveIndex, 0)),
+                                     transform.applyToPoint(mesh->getVertex(hit.primitiveIndex, 1)),
+                                     transform.applyToPoint(mesh->getVertex(hit.primitiveIndex, 2)), P);
 }
 
 Vector2 OBJ::getTextureCoordinates(const Vector3&) const {
-    throw std::runtime_error("TextureCoordinates should be handled by inner Triangle");
+    throw std::runtime_error("TextureCoordinates should be handled by the hit triangle");
 }
 
-void OBJ::rebuildBVH() {
-    delete bvh;
-    std::vector<std::shared_ptr<Shape>> triangleShapes;
-    for (const auto& t : triangles) {
-        triangleShapes.push_back(std::make_shared<Triangle>(t));
-    }
-    bvh = new BVHNode(triangleShapes);
+Vector2 OBJ::getHitTextureCoordinates(const Intersection& hit, const Vector3& intersection) const {
+    return mesh->getTextureCoordinates(hit.primitiveIndex, hit.barycentric);
 }
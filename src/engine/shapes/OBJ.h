@@ -1,32 +1,49 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <string>
 #include "Shape.h"
-#include "Triangle.h"
-#include "acceleration/BVHNode.h"
+#include "Mesh.h"
+#include "Transform.h"
+#include "acceleration/BVH.h"
 #include "Intersection.h"
 #include "Vector.h"
 
+/**
+ * @brief Instance of a shared Mesh placed in the scene by a transform.
+ * Rays are transformed into object space and traced through the mesh BVH; the
+ * instance itself carries the appearance (color, material, texture). Moving an
+ * instance only changes its world bounding box, never the mesh or its BVH.
+ */
 class OBJ : public Shape {
 public:
-    OBJ(const std::string& objFileName, const Vector3& position);
+    OBJ(const std::string& objFileName, const Vector3& position, const BVHBuildOptions& bvhOptions = {});
+    OBJ(std::shared_ptr<const Mesh> mesh, const Transform& transform);
 
     Intersection getIntersection(const Vector3& P, const Vector3& v) const override;
-    // void scale(double scale) override;
-    // void rotate(double angle, const Vector3& axis) override;
+    Intersection getIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax) const override;
+    bool hasIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax) const override;
+    bool forEachIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax,
+                             const IntersectionCallback& callback) const override;
     void setBoundingBox() override;
     Vector2 getTextureCoordinates(const Vector3& intersection) const override;
-    void rebuildBVH();
+    Vector2 getHitTextureCoordinates(const Intersection& hit, const Vector3& intersection) const override;
 
-    void update();
+    const Transform& getTransform() const { return transform; }
+    void setTransform(const Transform& newTransform);
+
+    const std::shared_ptr<const Mesh>& getMesh() const { return mesh; }
+    const BVH& getBVH() const { return mesh->getBVH(); }
+    size_t getTriangleCount() const { return mesh->getTriangleCount(); }
 
     double getDistanceNearestEdge(const Vector3& P, const Camera& camera) const override;
+    double getHitDistanceNearestEdge(const Intersection& hit, const Vector3& P, const Camera& camera) const override;
 
 private:
-    std::vector<Triangle> triangles;
-    BVHNode* bvh;
+    std::shared_ptr<const Mesh> mesh;
+    Transform transform;
 
-    Vector3 calculateCenter() const;
+    // Intersection de l'espace objet ramenée dans l'espace monde
+    Intersection toWorld(const Intersection& local) const;
 };
-
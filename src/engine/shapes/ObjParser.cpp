@@ -0,0 +1,270 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Vector.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+namespace {
+    // Coin de face sans coordonnées de texture, dans le résultat puis pendant l'analyse
+    constexpr uint32_t NO_UV = std::numeric_limits<uint32_t>::max();
+    constexpr int64_t NO_TEXTURE_INDEX = std::numeric_limits<int64_t>::min();
+
+    // Appelle fn(i) pour i dans [0, count[, en parallèle avec TBB
+    template <typename Fn>
+    void parallelFor(const size_t count, const Fn& fn) {
+#ifdef USE_TBB
+        tbb::parallel_for(size_t(0), count, fn);
+#else
+        for (size_t i = 0; i < count; ++i) fn(i);
+#endif
+    }
+
+    // Instructions d'un bloc du fichier, indices des faces pas encore résolus
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        std::vector<uint32_t> faceSizes;      ///< Nombre de coins de chaque face
+        std::vector<int64_t> cornerVertices;  ///< Indice 0-based du sommet de chaque coin
+        std::vector<int64_t> cornerUVs;       ///< Indice 0-based de la coordonnée de texture de chaque coin, ou NO_TEXTURE_INDEX
+        std::vector<size_t> relativeVertices; ///< Coins dont l'indice de sommet part du début du bloc
+        std::vector<size_t> relativeUVs;      ///< Coins dont l'indice de texture part du début du bloc
+        size_t vertexOffset = 0;              ///< Sommets définis par les blocs précédents
+        size_t uvOffset = 0;                  ///< Coordonnées de texture définies par les blocs précédents
+        std::vector<uint32_t> vertexIndices;  ///< Triangles du bloc, comme dans ObjData
+        std::vector<uint32_t> uvIndices;
+    };
+
+    bool isBlank(const char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skipBlanks(const char* p, const char* end) {
+        while (p < end && isBlank(*p)) ++p;
+        return p;
+    }
+
+    // Vrai si la ligne commence par le mot-clé suivi d'un blanc
+    bool startsWith(const char* p, const char* end, const char* keyword) {
+        const size_t length = std::strlen(keyword);
+        return static_cast<size_t>(end - p) > length && std::memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+    }
+
+    bool parseFloat(const char*& p, const char* end, float& value) {
+        p = skipBlanks(p, end);
+        if (p < end && *p == '+') ++p;
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    }
+
+    bool parseIndex(const char*& p, const char* end, int64_t& value) {
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value == 0) return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // Indice 0-based d'un indice OBJ : positif, compté depuis le début du fichier ;
+    // négatif, compté à rebours depuis le dernier élément défini (definedCount dans le
+    // bloc) et à décaler plus tard du nombre d'éléments des blocs précédents
+    int64_t toZeroBased(const int64_t index, const size_t definedCount, const size_t corner,
+                        std::vector<size_t>& relativeCorners) {
+        if (index > 0) return index - 1;
+        relativeCorners.push_back(corner);
+        return static_cast<int64_t>(definedCount) + index;
+    }
+
+    void parseChunk(Chunk& chunk, const std::string& fileName) {
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+            if (!lineEnd) lineEnd = chunk.end;
+            p = skipBlanks(p, lineEnd);
+
+            if (startsWith(p, lineEnd, "v")) {
+                p += 1;
+                float x, y, z;
+                if (!parseFloat(p, lineEnd, x) || !parseFloat(p, lineEnd, y) || !parseFloat(p, lineEnd, z)) {
+                    throw std::runtime_error("Malformed vertex in " + fileName);
+                }
+                chunk.positions.insert(chunk.positions.end(), {x, y, z});
+
+            } else if (startsWith(p, lineEnd, "vt")) {
+                p += 2;
+                float u, v = 0.0f;
+                if (!parseFloat(p, lineEnd, u)) {
+                    throw std::runtime_error("Malformed texture vertex in " + fileName);
+                }
+                parseFloat(p, lineEnd, v); // Coordonnée v facultative
+                chunk.uvs.insert(chunk.uvs.end(), {u, 1.0f - v}); // Inversion verticale
+
+            } else if (startsWith(p, lineEnd, "f")) {
+                p += 1;
+                uint32_t cornerCount = 0;
+                while (true) {
+                    p = skipBlanks(p, lineEnd);
+                    if (p == lineEnd || *p == '#') break;
+
+                    // v, v/vt, v//vn ou v/vt/vn ; la normale est ignorée
+                    const size_t corner = chunk.cornerVertices.size();
+                    int64_t vertex, texture = 0, normal;
+                    bool valid = parseIndex(p, lineEnd, vertex);
+                    if (valid && p < lineEnd && *p == '/') {
+                        ++p;
+                        if (p < lineEnd && *p != '/') valid = parseIndex(p, lineEnd, texture);
+                        if (valid && p < lineEnd && *p == '/') {
+                            ++p;
+                            valid = parseIndex(p, lineEnd, normal);
+                        }
+                    }
+                    if (!valid || (p < lineEnd && !isBlank(*p))) {
+                        throw std::runtime_error("Malformed face in " + fileName);
+                    }
+
+                    chunk.cornerVertices.push_back(
+                        toZeroBased(vertex, chunk.positions.size() / 3, corner, chunk.relativeVertices));
+                    chunk.cornerUVs.push_back(texture == 0
+                        ? NO_TEXTURE_INDEX : toZeroBased(texture, chunk.uvs.size() / 2, corner, chunk.relativeUVs));
+                    cornerCount++;
+                }
+                chunk.faceSizes.push_back(cornerCount);
+            }
+
+            // La dernière ligne du fichier peut ne pas finir par '\n' : pas de saut au-delà
+            p = lineEnd == chunk.end ? chunk.end : lineEnd + 1;
+        }
+    }
+
+    // Découpe des faces en triangles, une fois les indices de tous les blocs connus
+    void triangulateChunk(Chunk& chunk, const ObjData& data, const std::string& fileName) {
+        for (const size_t corner : chunk.relativeVertices) {
+            chunk.cornerVertices[corner] += static_cast<int64_t>(chunk.vertexOffset);
+        }
+        for (const size_t corner : chunk.relativeUVs) {
+            chunk.cornerUVs[corner] += static_cast<int64_t>(chunk.uvOffset);
+        }
+
+        const int64_t vertexCount = static_cast<int64_t>(data.positions.size() / 3);
+        const int64_t uvCount = static_cast<int64_t>(data.uvs.size() / 2);
+        for (const int64_t vertex : chunk.cornerVertices) {
+            if (vertex < 0 || vertex >= vertexCount) {
+                throw std::runtime_error("Invalid vertex index in " + fileName);
+            }
+        }
+        for (const int64_t uv : chunk.cornerUVs) {
+            if (uv != NO_TEXTURE_INDEX && (uv < 0 || uv >= uvCount)) {
+                throw std::runtime_error("Invalid texture index in " + fileName);
+            }
+        }
+
+        auto vertexAt = [&](const int64_t index) {
+            const float* position = &data.positions[3 * static_cast<size_t>(index)];
+            return Vector3(position[0], position[1], position[2]);
+        };
+
+        size_t first = 0;
+        for (const uint32_t faceSize : chunk.faceSizes) {
+            for (size_t i = 2; i < faceSize; ++i) {
+                const size_t corners[3] = {first, first + i - 1, first + i};
+                const Vector3 A = vertexAt(chunk.cornerVertices[corners[0]]);
+                const Vector3 B = vertexAt(chunk.cornerVertices[corners[1]]);
+                const Vector3 C = vertexAt(chunk.cornerVertices[corners[2]]);
+
+                // Triangle dégénéré (sommets confondus ou alignés) : pas de normale
+                if ((B - A).cross(C - A).norm() == 0.0) continue;
+
+                for (const size_t corner : corners) {
+                    chunk.vertexIndices.push_back(static_cast<uint32_t>(chunk.cornerVertices[corner]));
+                    const int64_t uv = chunk.cornerUVs[corner];
+                    chunk.uvIndices.push_back(uv == NO_TEXTURE_INDEX ? NO_UV : static_cast<uint32_t>(uv));
+                }
+            }
+            first += faceSize;
+        }
+    }
+
+    template <typename T>
+    void append(std::vector<T>& destination, const std::vector<T>& source) {
+        destination.insert(destination.end(), source.begin(), source.end());
+    }
+}
+
+ObjData ObjParser::parse(const std::string& fileName) {
+    const MappedFile file(fileName);
+    return parse(file, fileName);
+}
+
+ObjData ObjParser::parse(const MappedFile& file, const std::string& fileName) {
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    // Chaque bloc commence au début d'une ligne : sa borne nominale est reportée
+    // après la fin de ligne suivante
+    const size_t chunkCount = std::max<size_t>(1, size / CHUNK_SIZE);
+    std::vector<Chunk> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const char* begin = i == 0 ? data : chunks[i - 1].end;
+        const char* end = data + size;
+        if (i + 1 < chunkCount) {
+            end = std::max(begin, data + (i + 1) * size / chunkCount);
+            const void* newline = std::memchr(end, '\n', data + size - end);
+            end = newline ? static_cast<const char*>(newline) + 1 : data + size;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+    }
+
+    parallelFor(chunkCount, [&](const size_t i) { parseChunk(chunks[i], fileName); });
+
+    ObjData result;
+    size_t vertexFloats = 0;
+    size_t uvFloats = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.vertexOffset = vertexFloats / 3;
+        chunk.uvOffset = uvFloats / 2;
+        vertexFloats += chunk.positions.size();
+        uvFloats += chunk.uvs.size();
+    }
+    result.positions.reserve(vertexFloats);
+    result.uvs.reserve(uvFloats);
+    for (Chunk& chunk : chunks) {
+        append(result.positions, chunk.positions);
+        append(result.uvs, chunk.uvs);
+        chunk.positions = {};
+        chunk.uvs = {};
+    }
+
+    parallelFor(chunkCount, [&](const size_t i) { triangulateChunk(chunks[i], result, fileName); });
+
+    size_t indexCount = 0;
+    for (const Chunk& chunk : chunks) indexCount += chunk.vertexIndices.size();
+    result.vertexIndices.reserve(indexCount);
+    result.uvIndices.reserve(indexCount);
+    for (const Chunk& chunk : chunks) {
+        append(result.vertexIndices, chunk.vertexIndices);
+        append(result.uvIndices, chunk.uvIndices);
+    }
+
+    // Sans aucune coordonnée de texture, tous les sommets auraient (0, 0) ; sinon les
+    // coins sans coordonnées reçoivent un (0, 0) ajouté après celles du fichier
+    if (result.uvs.empty()) {
+        result.uvIndices.clear();
+    } else if (std::find(result.uvIndices.begin(), result.uvIndices.end(), NO_UV) != result.uvIndices.end()) {
+        const uint32_t zeroUV = static_cast<uint32_t>(result.uvs.size() / 2);
+        result.uvs.insert(result.uvs.end(), {0.0f, 0.0f});
+        std::replace(result.uvIndices.begin(), result.uvIndices.end(), NO_UV, zeroUV);
+    }
+
+    return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * @brief Triangles of an OBJ file in indexed form, as stored by Mesh
+ */
+struct ObjData {
+    std::vector<float> positions;        ///< x, y, z of each vertex
+    std::vector<float> uvs;              ///< u, v of each texture vertex, v flipped
+    std::vector<uint32_t> vertexIndices; ///< Three vertex indices per triangle
+    std::vector<uint32_t> uvIndices;     ///< Three texture vertex indices per triangle, empty without texture coordinates
+};
+
+/**
+ * @brief Reader for the v, vt and f statements of an OBJ file, other statements are ignored.
+ * The mapped file is cut into chunks at line boundaries and the chunks are parsed in
+ * parallel with std::from_chars, then stitched back in file order. Faces may be
+ * polygons, split into triangle fans, and their indices may be negative (counted
+ * back from the last vertex defined before the face). Degenerate triangles are dropped.
+ */
+class ObjParser {
+public:
+    /// Target size of a chunk: large enough to amortize a task, small enough to balance the threads
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+    /// @throws std::runtime_error on a malformed statement or an index out of range
+    static ObjData parse(const MappedFile& file, const std::string& fileName);
+
+    /// @throws std::runtime_error if the file cannot be mapped, or as above
+    static ObjData parse(const std::string& fileName);
+};
@@ -1,6 +1,4 @@
 #include "Plane.h"
-
-#include "../acceleration/BoundingBox.h"
 #include "../scenes/Scene.h"
 
 Plane::Plane(const Vector3& n, const double d)
@@ -31,6 +29,16 @@ Intersection Plane::getIntersection(const Vector3& P, const Vector3& v) const {
     return (lambda >= 0) ? Intersection(lambda, normal, this) : Intersection();
 }
 
+bool Plane::hasIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    if (!visible) return false;
+
+    const double denominator = normal.dot(v);
+    if (std::abs(denominator) < Scene::EPSILON) return false;
+
+    const double lambda = -(normal.dot(P) + distance) / denominator;
+    return lambda >= tMin && lambda < tMax;
+}
+
 void Plane::setBoundingBox() {
     const Vector3 min(-std::numeric_limits<double>::max(),
                 -std::numeric_limits<double>::max(),
@@ -40,7 +48,7 @@ void Plane::setBoundingBox() {
                 std::numeric_limits<double>::max(),
                 std::numeric_limits<double>::max());
 
-    this->boundingBox = std::make_shared<BoundingBox>(min, max);
+    this->boundingBox = AABB(min, max);
 }
 
 
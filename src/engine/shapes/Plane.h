@@ -17,9 +17,11 @@ public:
 
     // Shape interface implementation
     Intersection getIntersection(const Vector3& P, const Vector3& v) const override;
+    bool hasIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax) const override;
     // void scale(double scale) override;
     // void rotate(double angle, const Vector3& axis) override;
     void setBoundingBox() override;
+    bool isBounded() const override { return false; }
     Vector2 getTextureCoordinates(const Vector3& intersection) const override;
 
     double getDistanceNearestEdge(const Vector3& P, const Camera& camera) const override;
@@ -1 +1,21 @@
 #include "Shape.h"
+#include "scenes/Scene.h"
+
+bool Shape::forEachIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax,
+                                const IntersectionCallback& callback) const {
+    double offset = 0.0;
+    while (true) {
+        const Intersection inter = getIntersection(P + v * offset, v);
+        if (!inter) return true;
+
+        // Distance mesurée depuis l'origine du rayon initial
+        const double t = offset + inter.lambda;
+        if (t >= tMax) return true;
+
+        if (t >= tMin && !callback(Intersection(t, inter.normal, inter.shape))) {
+            return false;
+        }
+
+        offset = t + Scene::EPSILON;
+    }
+}
@@ -7,8 +7,7 @@
 #include "Material.h"
 #include "Texture.h"
 #include "../Intersection.h"
-
-class BoundingBox;
+#include "../acceleration/AABB.h"
 
 /**
  * @brief Abstract base class representing a 3D geometric shape for ray tracing
@@ -19,10 +18,17 @@ protected:
     Vector3 color_ = {1.0f, 1.0f, 1.0f};  ///< Base color (if no texture)
     Material material_;
     bool visible = true;                 ///< Visibility flag
-    std::shared_ptr<BoundingBox> boundingBox; ///< Acceleration structure
+    AABB boundingBox;                    ///< Bounds used by the acceleration structure, stored inline
     std::shared_ptr<Texture> texture = nullptr; ///< Optional texture
     bool hasTexture_ = false;               ///< Texture presence flag
     bool wireframeEnabled = false;        ///< Wireframe mode flag
+    bool boundsDirty = false;             ///< Set when the geometry moved since the acceleration structure last saw it
+
+    /**
+     * @brief Called by setters that change the shape's extent, so the renderer
+     * moves it in the acceleration structure before the next frame
+     */
+    void markBoundsDirty() { boundsDirty = true; }
 
 public:
     virtual ~Shape() = default;
@@ -31,6 +37,35 @@ public:
     virtual Intersection getIntersection(const Vector3& P, const Vector3& v) const = 0;
     virtual Vector2 getTextureCoordinates(const Vector3& intersection) const = 0;
 
+    /**
+     * @brief Closest hit of the ray with the shape at a distance in [tMin, tMax[.
+     * The default implementation only filters getIntersection, so a shape whose
+     * nearest hit lies before tMin reports none; composite shapes override it to
+     * search the interval itself
+     */
+    virtual Intersection getIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+        const Intersection inter = getIntersection(P, v);
+        return inter.lambda >= tMin && inter.lambda < tMax ? inter : Intersection();
+    }
+
+    /**
+     * @brief Any-hit test used by shadow rays: only tells whether the ray hits the
+     * shape at a distance in [tMin, tMax[, without computing normal or hit data
+     */
+    virtual bool hasIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+        const Intersection inter = getIntersection(P, v);
+        return inter.lambda >= tMin && inter.lambda < tMax;
+    }
+
+    /**
+     * @brief Reports every hit of the ray with the shape at a distance in [tMin, tMax[
+     * (in no particular order). The default implementation restarts getIntersection
+     * just past each hit, which also catches the exit point of closed shapes
+     * @return false if the callback stopped the enumeration
+     */
+    virtual bool forEachIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax,
+                                     const IntersectionCallback& callback) const;
+
     Vector3 getColor() const { return color_; }
     void setColor(const Vector3& col) { color_ = col; }
 
@@ -44,7 +79,11 @@ public:
 
     // Bounding volume
     virtual void setBoundingBox() = 0;
-    std::shared_ptr<BoundingBox> getBoundingBox() const { return boundingBox; }
+    /// False for infinite shapes (planes): they are kept out of the BVH and tested directly
+    virtual bool isBounded() const { return true; }
+    const AABB& getBoundingBox() const { return boundingBox; }
+    bool isBoundsDirty() const { return boundsDirty; }
+    void clearBoundsDirty() { boundsDirty = false; }
 
     // Getters/Setters
     bool isVisible() const { return visible; }
@@ -63,6 +102,18 @@ public:
 
     virtual double getDistanceNearestEdge(const Vector3& P, const Camera& camera) const = 0;
 
+    /**
+     * @brief Hit-aware variants of the point queries above. Composite shapes (mesh
+     * instances) override them to forward to the primitive recorded in the hit
+     */
+    virtual Vector2 getHitTextureCoordinates(const Intersection& hit, const Vector3& intersection) const {
+        return getTextureCoordinates(intersection);
+    }
+
+    virtual double getHitDistanceNearestEdge(const Intersection& hit, const Vector3& P, const Camera& camera) const {
+        return getDistanceNearestEdge(P, camera);
+    }
+
     virtual std::string toString() const {
         return typeid(*this).name();
     }
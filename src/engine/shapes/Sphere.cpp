@@ -1,7 +1,5 @@
 #include "Sphere.h"
 
-#include "../acceleration/BoundingBox.h"
-
 #ifdef _WIN32
   #include <corecrt_math_defines.h>  // Windows (Visual Studio)
 #endif
@@ -34,6 +32,25 @@ Intersection Sphere::getIntersection(const Vector3& P, const Vector3& v) const {
     return Intersection();
 }
 
+bool Sphere::hasIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    if (!visible) return false;
+
+    const Vector3 PC = P - center;
+    const double a = v.dot(v);
+    const double b = 2.0 * PC.dot(v);
+    const double c = PC.dot(PC) - radius * radius;
+
+    const double discriminant = b * b - 4.0 * a * c;
+    if (discriminant < 0) return false;
+
+    const double sqrtDiscriminant = std::sqrt(discriminant);
+    const double lambda1 = (-b - sqrtDiscriminant) / (2.0 * a);
+    if (lambda1 >= tMin && lambda1 < tMax) return true;
+
+    const double lambda2 = (-b + sqrtDiscriminant) / (2.0 * a);
+    return lambda2 >= tMin && lambda2 < tMax;
+}
+
 Vector3 Sphere::getNormal(const Vector3& P) const {
     return (P - center).normalized();
 }
@@ -47,10 +64,22 @@ Vector3 Sphere::getNormal(const Vector3& P) const {
 //     // Rotation has no effect on a sphere
 // }
 
+void Sphere::setCenter(const Vector3& P) {
+    center = P;
+    setBoundingBox();
+    markBoundsDirty();
+}
+
+void Sphere::setRadius(const float r) {
+    radius = r;
+    setBoundingBox();
+    markBoundsDirty();
+}
+
 void Sphere::setBoundingBox() {
     Vector3 min = center - Vector3(radius, radius, radius);
     Vector3 max = center + Vector3(radius, radius, radius);
-    boundingBox = std::make_shared<BoundingBox>(min, max);
+    boundingBox = AABB(min, max);
 }
 
 Vector2 Sphere::getTextureCoordinates(const Vector3& intersection) const {
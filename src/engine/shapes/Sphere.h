@@ -13,8 +13,14 @@ public:
     Sphere(const Vector3& P, float radius);
 
     Intersection getIntersection(const Vector3& P, const Vector3& v) const override;
+    bool hasIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax) const override;
     Vector3 getNormal(const Vector3& P) const;
 
+    const Vector3& getCenter() const { return center; }
+    float getRadius() const { return radius; }
+    void setCenter(const Vector3& P);
+    void setRadius(float r);
+
     // void scale(float scale) override;
     // void rotate(float angle, const Vector3& axis) override;
 
@@ -1,12 +1,63 @@
 #include "Triangle.h"
 #include <algorithm> // for std::min/std::max
-
-#include "acceleration/BoundingBox.h"
+#include <cmath>
+#include <limits>
 #include "scenes/Scene.h"
 
+namespace {
+    // Majoration de l'erreur d'arrondi relative d'un test d'arête, en epsilons machine
+    constexpr double EDGE_TEST_ROUNDING = 8.0 * std::numeric_limits<double>::epsilon();
+
+    double maxAbs(const Vector3& v) {
+        return std::max({std::abs(v[0]), std::abs(v[1]), std::abs(v[2])});
+    }
+
+    double sumAbs(const Vector3& v) {
+        return std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+    }
+
+    // Moment de Plücker P x Q de l'arête P -> Q. Le produit vectoriel est toujours
+    // calculé avec les extrémités dans le même ordre, puis changé de signe : les deux
+    // triangles qui partagent une arête obtiennent des moments exactement opposés,
+    // même si le compilateur contracte les produits en FMA
+    Vector3 edgeMoment(const Vector3& P, const Vector3& Q) {
+        if (std::lexicographical_compare(P.begin(), P.end(), Q.begin(), Q.end())) {
+            return P.cross(Q);
+        }
+        return -Q.cross(P);
+    }
+
+    // Tests d'arête du rayon (P, v), rangés dans sums dans l'ordre BC, CA, AB. Renvoie
+    // false si le rayon passe à l'extérieur d'une arête et à l'intérieur d'une autre.
+    // Le moment du rayon P x v est commun aux trois tests, et un test ne dépend que du
+    // rayon et de son arête. Un test plus petit que son erreur d'arrondi (rayon sur
+    // l'arête ou sur un sommet) compte des deux côtés : tous les triangles autour d'un
+    // sommet visé exactement sont touchés
+    bool edgeTests(const Vector3& P, const Vector3& v,
+                   const Vector3& edgeBC, const Vector3& momentBC,
+                   const Vector3& edgeCA, const Vector3& momentCA,
+                   const Vector3& edgeAB, const Vector3& momentAB,
+                   const double vertexScale, const double edgeScale, double sums[3]) {
+        const Vector3 rayMoment = P.cross(v);
+        sums[0] = v.dot(momentBC) + edgeBC.dot(rayMoment);
+        sums[1] = v.dot(momentCA) + edgeCA.dot(rayMoment);
+        sums[2] = v.dot(momentAB) + edgeAB.dot(rayMoment);
+
+        const double tolerance = EDGE_TEST_ROUNDING * sumAbs(v) * (vertexScale + edgeScale * maxAbs(P));
+        if ((sums[0] < -tolerance || sums[1] < -tolerance || sums[2] < -tolerance)
+            && (sums[0] > tolerance || sums[1] > tolerance || sums[2] > tolerance)) return false;
+
+        // Somme nulle : triangle dégénéré, sans coordonnées barycentriques
+        return sums[0] + sums[1] + sums[2] != 0.0;
+    }
+}
+
 Triangle::Triangle(const Vector3& A, const Vector3& B, const Vector3& C)
-    : Plane(A, B - A, C - A), A(A), B(B), C(C), hasUV(false)
+    : Plane(A, B - A, C - A), A(A), B(B), C(C), hasUV(false),
+      edgeAB(B - A), edgeBC(C - B), edgeCA(A - C),
+      momentAB(edgeMoment(A, B)), momentBC(edgeMoment(B, C)), momentCA(edgeMoment(C, A))
 {
+    growToleranceScales(A, B, C, vertexScale, edgeScale);
     Triangle::setBoundingBox();
 }
 
@@ -14,30 +65,85 @@ std::vector<Vector3> Triangle::getVertices() const {
     return {A, B, C};
 }
 
-Intersection Triangle::getIntersection(const Vector3& P, const Vector3& v) const {
-    if (!visible) return Intersection();
+bool Triangle::intersect(const Vector3& P, const Vector3& v, const double tMin, const double tMax,
+                         double& lambda, double* sums) const {
+    double edgeSums[3];
+    if (!edgeTests(P, v, edgeBC, momentBC, edgeCA, momentCA, edgeAB, momentAB, vertexScale, edgeScale, edgeSums)) {
+        return false;
+    }
+
+    // Rayon dans le plan du triangle
+    const double denominator = normal.dot(v);
+    if (denominator == 0.0) return false;
+
+    lambda = -(normal.dot(P) + distance) / denominator;
+    if (lambda < tMin || lambda >= tMax) return false;
+
+    if (sums) {
+        std::copy(edgeSums, edgeSums + 3, sums);
+    }
+    return true;
+}
+
+void Triangle::growToleranceScales(const Vector3& A, const Vector3& B, const Vector3& C,
+                                   double& vertexScale, double& edgeScale) {
+    const double vertexMax = std::max({maxAbs(A), maxAbs(B), maxAbs(C)});
+    vertexScale = std::max(vertexScale, vertexMax * vertexMax);
+    edgeScale = std::max({edgeScale, sumAbs(B - A), sumAbs(C - B), sumAbs(A - C)});
+}
+
+bool Triangle::intersect(const Vector3& A, const Vector3& B, const Vector3& C,
+                         const double vertexScale, const double edgeScale,
+                         const Vector3& P, const Vector3& v, const double tMin, const double tMax,
+                         double& lambda, double* sums, Vector3* normal) {
+    // Mêmes arêtes et moments que ceux précalculés par le constructeur
+    const Vector3 edgeAB = B - A;
+    const Vector3 edgeBC = C - B;
+    const Vector3 edgeCA = A - C;
+
+    double edgeSums[3];
+    if (!edgeTests(P, v, edgeBC, edgeMoment(B, C), edgeCA, edgeMoment(C, A), edgeAB, edgeMoment(A, B),
+                   vertexScale, edgeScale, edgeSums)) {
+        return false;
+    }
+
+    // Distance par la normale non normalisée : la racine n'est calculée que si
+    // l'appelant demande la normale
+    const Vector3 n = edgeAB.cross(C - A);
+    const double denominator = n.dot(v);
+    if (denominator == 0.0) return false;
 
-    // Appel à la méthode de la classe parente Plane
-    const Intersection inter = Plane::getIntersection(P, v);
-    if (inter.lambda < Scene::EPSILON) return Intersection();
+    lambda = n.dot(A - P) / denominator;
+    if (lambda < tMin || lambda >= tMax) return false;
 
-    const Vector3 I = P + v * inter.lambda;
-    return isInside(I) ? inter : Intersection();
+    if (sums) {
+        std::copy(edgeSums, edgeSums + 3, sums);
+    }
+    if (normal) {
+        *normal = n.normalized();
+    }
+    return true;
 }
 
+Intersection Triangle::getIntersection(const Vector3& P, const Vector3& v) const {
+    if (!visible) return Intersection();
 
-bool Triangle::isInside(const Vector3& M) const {
-    const Vector3 MA = A - M;
-    const Vector3 MB = B - M;
-    const Vector3 MC = C - M;
+    double lambda;
+    double sums[3];
+    if (!intersect(P, v, Scene::EPSILON, std::numeric_limits<double>::infinity(), lambda, sums)) {
+        return Intersection();
+    }
 
-    const double norme2 = normal.norm() * normal.norm();
+    // Chaque test d'arête est proportionnel au poids du sommet opposé
+    const double inverseSum = 1.0 / (sums[0] + sums[1] + sums[2]);
+    return Intersection(lambda, normal, this, 0, Vector2(sums[1] * inverseSum, sums[2] * inverseSum));
+}
 
-    const double alpha = normal.dot(MB.cross(MC)) / norme2;
-    const double beta  = normal.dot(MC.cross(MA)) / norme2;
-    const double gamma = normal.dot(MA.cross(MB)) / norme2;
+bool Triangle::hasIntersection(const Vector3& P, const Vector3& v, const double tMin, const double tMax) const {
+    if (!visible) return false;
 
-    return (alpha >= 0) && (beta >= 0) && (gamma >= 0);
+    double lambda;
+    return intersect(P, v, tMin, tMax, lambda);
 }
 
 // void Triangle::scale(double scale) {
@@ -71,7 +177,7 @@ bool Triangle::isInside(const Vector3& M) const {
 void Triangle::setBoundingBox() {
     const Vector3 minV = A.min(B).min(C);
     const Vector3 maxV = A.max(B).max(C);
-    boundingBox = std::make_shared<BoundingBox>(minV, maxV);
+    boundingBox = AABB(minV, maxV);
 }
 
 Vector2 Triangle::getTextureCoordinates(const Vector3& intersection) const {
@@ -106,6 +212,17 @@ Vector2 Triangle::getTextureCoordinates(const Vector3& intersection) const {
     }
 }
 
+Vector2 Triangle::getHitTextureCoordinates(const Intersection& hit, const Vector3& intersection) const {
+    if (!hasUV) {
+        return getTextureCoordinates(intersection);
+    }
+
+    const double u = hit.barycentric[0];
+    const double v = hit.barycentric[1];
+    const Vector3 uv = uvA * (1.0 - u - v) + uvB * u + uvC * v;
+    return Vector2(uv[0], uv[1]);
+}
+
 void Triangle::setTextureCoordinates(const Vector3& a, const Vector3& b, const Vector3& c) {
     uvA = a;
     uvB = b;
@@ -128,6 +245,10 @@ double distancePointSegment(const Vector3& P, const Vector3& A, const Vector3& B
 }
 
 double Triangle::getDistanceNearestEdge(const Vector3& P, const Camera& camera) const {
+    return distanceToEdges(A, B, C, P);
+}
+
+double Triangle::distanceToEdges(const Vector3& A, const Vector3& B, const Vector3& C, const Vector3& P) {
     double d1 = distancePointSegment(P, A, B);
     double d2 = distancePointSegment(P, B, C);
     double d3 = distancePointSegment(P, C, A);
@@ -4,11 +4,24 @@
 #include "Vector.h"
 #include "Intersection.h"
 
+/**
+ * @brief Triangle ABC, intersected by a dedicated kernel rather than through its plane.
+ * The edge directions and their Plücker moments are precomputed: each edge test is
+ * the Möller–Trumbore edge test evaluated about the world origin instead of vertex A,
+ * so two triangles sharing an edge compute exactly opposite values for it and a ray
+ * crossing that edge always hits one of them (watertight, no pinholes in meshes).
+ * Tests within their rounding error of zero count as inside, which also closes the
+ * fan of triangles around a vertex hit exactly.
+ */
 class Triangle : public Plane {
 protected:
     Vector3 A, B, C;
     Vector3 uvA, uvB, uvC;
     bool hasUV = false;
+    Vector3 edgeAB, edgeBC, edgeCA;       ///< Edge directions, B - A, C - B and A - C
+    Vector3 momentAB, momentBC, momentCA; ///< Plücker moments of the edges, A x B, B x C and C x A
+    double vertexScale = 0.0;             ///< Largest squared vertex coordinate, bounds the moments
+    double edgeScale = 0.0;               ///< Largest edge L1 norm
 
 public:
     Triangle(const Vector3& A, const Vector3& B, const Vector3& C);
@@ -16,19 +29,49 @@ public:
     std::vector<Vector3> getVertices() const;
 
     Intersection getIntersection(const Vector3& P, const Vector3& v) const override;
+    bool hasIntersection(const Vector3& P, const Vector3& v, double tMin, double tMax) const override;
 
     // void scale(double scale) override;
     //
     // void rotate(double angle, const Vector3& axis) override;
 
     void setBoundingBox() override;
+    bool isBounded() const override { return true; }
 
     Vector2 getTextureCoordinates(const Vector3& intersection) const override;
+    Vector2 getHitTextureCoordinates(const Intersection& hit, const Vector3& intersection) const override;
 
     void setTextureCoordinates(const Vector3& a, const Vector3& b, const Vector3& c);
 
     double getDistanceNearestEdge(const Vector3& P, const Camera& camera) const override;
 
+    /**
+     * @brief Same test as a Triangle built on A, B and C, with the edges and moments
+     * computed on the fly: used for indexed mesh triangles, which store only vertex indices
+     * @param vertexScale, edgeScale Bounds of the rounding tolerance, from growToleranceScales:
+     * a mesh passes the largest ones over all its triangles
+     * @param sums If not null, receives the three edge tests (opposite A, B and C)
+     * @param normal If not null, receives the unit normal of the hit triangle
+     */
+    static bool intersect(const Vector3& A, const Vector3& B, const Vector3& C,
+                          double vertexScale, double edgeScale,
+                          const Vector3& P, const Vector3& v, double tMin, double tMax,
+                          double& lambda, double* sums = nullptr, Vector3* normal = nullptr);
+
+    /// Raises vertexScale and edgeScale to cover the triangle ABC
+    static void growToleranceScales(const Vector3& A, const Vector3& B, const Vector3& C,
+                                    double& vertexScale, double& edgeScale);
+
+    /// Distance from P to the nearest edge of the triangle ABC
+    static double distanceToEdges(const Vector3& A, const Vector3& B, const Vector3& C, const Vector3& P);
+
 private:
-    bool isInside(const Vector3& M) const;
+    /**
+     * @brief Intersection kernel shared by the queries: true if the ray (P, v) hits the
+     * triangle at a distance in [tMin, tMax[, which is then stored in lambda
+     * @param sums If not null, receives the three edge tests (opposite A, B and C), from
+     * which the barycentric coordinates are obtained by dividing by their sum
+     */
+    bool intersect(const Vector3& P, const Vector3& v, double tMin, double tMax,
+                   double& lambda, double* sums = nullptr) const;
 };
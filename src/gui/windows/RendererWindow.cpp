@@ -25,6 +25,26 @@ void texture(Application& m_renderer)
     ImGui::Checkbox("Enable texture", &m_renderer.renderer.textureEnabled);
 }
 
+void packets(Application& m_renderer) {
+    static const int sizes[] = {1, 4, 8, 16};
+    int selected = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (sizes[i] == m_renderer.renderer.packetSize) selected = i;
+    }
+    if (ImGui::Combo("Primary ray packets", &selected, "Off\0" "4 rays\0" "8 rays\0" "16 rays\0")) {
+        m_renderer.renderer.packetSize = sizes[selected];
+    }
+    ImGui::Checkbox("Wavefront integrator", &m_renderer.renderer.wavefrontEnabled);
+}
+
+void accelerator(Application& m_renderer) {
+    int selected = static_cast<int>(m_renderer.renderer.getAcceleratorType());
+    if (ImGui::Combo("Acceleration structure", &selected, "BVH\0" "Uniform grid\0" "Kd-tree\0") && !m_renderer.isRendering) {
+        m_renderer.renderer.setAcceleratorType(static_cast<AcceleratorType>(selected));
+        m_renderer.triggerRerender();
+    }
+}
+
 void shadow(Application& m_renderer) {
     ImGui::Checkbox("Enable Shadows", &m_renderer.renderer.shadowsEnabled);
     if (m_renderer.renderer.shadowsEnabled) {
@@ -79,6 +99,10 @@ void RendererWindow::render() {
 
         texture(m_renderer);
 
+        packets(m_renderer);
+
+        accelerator(m_renderer);
+
         ImGui::Separator();
 
         shadow(m_renderer);
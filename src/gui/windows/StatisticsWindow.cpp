@@ -23,6 +23,20 @@ void StatisticsWindow::render() {
                 const double pixelsPerSecond = (m_renderer.imageWidth * m_renderer.imageHeight) / m_renderer.renderTime;
                 ImGui::Text("Pixels/second: %.0f", pixelsPerSecond);
             }
+
+            const Accelerator& accelerator = m_renderer.renderer.getAccelerator();
+            const AcceleratorStats& stats = accelerator.getStats();
+            ImGui::Separator();
+            ImGui::Text("Accelerator: %s", accelerator.getName());
+            if (accelerator.getType() == AcceleratorType::Grid) {
+                ImGui::Text("Grid cells: %zu (%zu non-empty)", stats.nodeCount, stats.leafCount);
+            } else {
+                ImGui::Text("Nodes: %zu (%zu leaves)", stats.nodeCount, stats.leafCount);
+            }
+            ImGui::Text("Primitive references: %zu", stats.primitiveCount);
+            ImGui::Text("Unbounded shapes: %zu", stats.unboundedCount);
+            ImGui::Text("Memory: %.1f KiB (%.0f B/node)", stats.bytes / 1024.0, stats.bytesPerNode());
+            ImGui::Text("Build: %.2f ms", stats.buildMilliseconds);
         }
     }
     ImGui::End();